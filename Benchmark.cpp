@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#define BENCHMARK_EDGES 64
+#define MIN_BENCHMARK_PERIOD 2
+
+Benchmark::Benchmark()
+  : generated(0), due(0), stamp(0), period(0), processed(0), lost(0), longest(0), edge(0), latencies{0}, running(false), measuring(false) {
+}
+
+void Benchmark::start(uint16_t ticks) {
+  stop();
+  period = ticks < MIN_BENCHMARK_PERIOD ? MIN_BENCHMARK_PERIOD : ticks > MAX_TIMER_TICKS ? MAX_TIMER_TICKS : ticks;
+  processed = 0;
+  lost = 0;
+  longest = 0;
+  measuring = false;
+  for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) latencies[bucket] = 0;
+  noInterrupts();
+  generated = 0;
+  due = Timer::now() + period;
+  Timer::scheduleB(due);
+  interrupts();
+  running = true;
+}
+
+void Benchmark::stop() {
+  Timer::cancelB();
+  running = false;
+}
+
+void Benchmark::tick() {
+  stamp = due;
+  ++generated;
+  due += period;
+  if (generated < BENCHMARK_EDGES) Timer::scheduleB(due);
+  else Timer::cancelB();
+}
+
+Signal Benchmark::signal() {
+  noInterrupts();
+  uint16_t count = generated;
+  uint16_t at = stamp;
+  interrupts();
+  Signal signal = Signal::Low;
+  if (count != processed + lost) {
+    lost = count - processed - 1;
+    ++processed;
+    edge = at;
+    measuring = true;
+    signal = Signal::Rising;
+  } else if (count == BENCHMARK_EDGES) {
+    running = false;
+  } else if (count > 0 && (uint16_t)(Timer::now() - edge) < period / 2) {
+    signal = Signal::High;
+  }
+  return signal;
+}
+
+void Benchmark::measure() {
+  if (measuring) {
+    uint16_t latency = Timer::now() - edge;
+    if (latency > longest) longest = latency;
+    int bucket = 0;
+    for (; latency > 0 && bucket < LATENCY_BUCKETS - 1; latency >>= 1) ++bucket;
+    ++latencies[bucket];
+    measuring = false;
+  }
+}
+
+bool Benchmark::isRunning() {
+  return running;
+}
+
+BenchmarkResult Benchmark::read() {
+  noInterrupts();
+  BenchmarkResult result = BenchmarkResult{running, period, generated, processed, lost, longest, {0}};
+  interrupts();
+  for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) result.latencies[bucket] = latencies[bucket];
+  return result;
+}
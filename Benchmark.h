@@ -0,0 +1,43 @@
+#ifndef Benchmark_h_
+#define Benchmark_h_
+
+#include "Io.h"
+#include "Timer.h"
+
+#define LATENCY_BUCKETS 8
+
+struct BenchmarkResult {
+  bool running;
+  uint16_t period;
+  uint16_t generated;
+  uint16_t processed;
+  uint16_t lost;
+  uint16_t longest;
+  byte latencies[LATENCY_BUCKETS];
+};
+
+class Benchmark {
+public:
+  Benchmark();
+  void start(uint16_t period);
+  void stop();
+  void tick();
+  Signal signal();
+  void measure();
+  bool isRunning();
+  BenchmarkResult read();
+private:
+  volatile uint16_t generated;
+  volatile uint16_t due;
+  volatile uint16_t stamp;
+  uint16_t period;
+  uint16_t processed;
+  uint16_t lost;
+  uint16_t longest;
+  uint16_t edge;
+  byte latencies[LATENCY_BUCKETS];
+  bool running;
+  bool measuring;
+};
+
+#endif
@@ -14,10 +14,10 @@ struct ButtonEvent {
   ButtonState state;
 };
 
-class Buttons : public Controller {
+class Buttons {
 public:
   Buttons();
-  virtual void initialise();
+  void initialise();
   ButtonEvent event();
   bool isHeld();
 private:
@@ -16,7 +16,7 @@
 #define MAX_MULTIPLIER 4
 
 ClockGenerator::ClockGenerator()
- : last(millis()), speed(120), width(0), running(false) {
+ : last(millis()), speed(120), width(0), multiplier(0), running(false) {
 }
 
 Signal ClockGenerator::tick() {
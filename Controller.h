@@ -1,8 +1,6 @@
 #ifndef Controller_h_
 #define Controller_h_
 
-#include "HardwareInterface.h"
-
 enum Control {
   One = 0,
   Two = 1,
@@ -10,9 +8,4 @@ enum Control {
   NoControl = 99
 };
 
-class Controller : public HardwareInterface {
-public:
-private:
-};
-
 #endif
@@ -4,8 +4,14 @@
 #define row(t) (t * 2)
 
 #define UNLIMITED 0
+#define FRAME_RATE 100
+#define REFRESH_TIME (1000 / FRAME_RATE)
+#define ROWS_PER_PASS 2
+#define BOOT_FRAMES 7
+#define BOOT_FRAME_TIME 100
 #define INDICATOR_TIME 25
 #define TRACK_INDICATOR_TIME 300
+#define OVERRUN_INDICATOR_TIME 500
 #define MODE_FRAME_TIME 500
 #define FLASH_TIME_ON 50
 #define FLASH_TIME_OFF 100
@@ -13,23 +19,29 @@
 #define MODE_ROW 6
 #define CLOCK_INDICATOR 0
 #define RESET_INDICATOR 1
+#define OVERRUN_INDICATOR 6
 #define TRACK_ONE_INDICATOR 2
 #define TRACK_TWO_INDICATOR 5
 #define TRACK_THREE_INDICATOR 7
 #define OFF_BEAT_INDICATOR 3
 #define MATRIX_ROWS 8
 #define MATRIX_COLUMNS 8
-#define ALL_ON 255
+#define ROW_MASK 0xFFULL
+#define TRACK_ROWS_MASK 0xFFFFULL
 #define LED_ON 1
-#define ALL_OFF 0
 #define LED_OFF 0
 #define TRACKS 3
+#define PRESET_CELL 0x0303ULL
+#define PRESET_COLUMNS 4
 #define CURSORS TRACKS
+#define GROOVE_ROWS 4
+#define GROOVE_SCALE 48
 
 Display::Display()
   : frame{0, 0, 0, false},
     clock{INDICATOR_ROW, CLOCK_INDICATOR, false, 0},
     reset{INDICATOR_ROW, RESET_INDICATOR, false, 0},
+    overrun{INDICATOR_ROW, OVERRUN_INDICATOR, false, 0},
     tracks{{INDICATOR_ROW, TRACK_ONE_INDICATOR, false, 0},
       {INDICATOR_ROW, TRACK_TWO_INDICATOR, false, 0},
       {INDICATOR_ROW, TRACK_THREE_INDICATOR, false, 0},
@@ -38,25 +50,62 @@ Display::Display()
 
 void Display::initialise() {
   matrix.initialise();
-  simley();
+  bootStart = millis();
+  booting = true;
 }
 
 void Display::render() {
+  if (isDue()) refresh();
+  flush(ROWS_PER_PASS);
+}
+
+bool Display::isDue() {
+  return composed == shown && (millis() - refreshTime) >= REFRESH_TIME;
+}
+
+void Display::refresh() {
+  refreshTime = millis();
   updateFlashState();
   updateFrame();
   updateCursors();
   updateIndicators();
+  composed = compose();
+}
 
-  for (int row = 0; row < MATRIX_ROWS; ++ row) {
-    if (frame.active) matrix.setRow(row, getFrameRow(row));
-    else matrix.setRow(row, display[row].state ^ cursorMask[row].state);
+void Display::flush(int rows) {
+  for (int row = 0; row < MATRIX_ROWS && rows > 0 && composed != shown; ++row) {
+    uint64_t mask = ROW_MASK << row * MATRIX_COLUMNS;
+    if ((composed ^ shown) & mask) {
+      matrix.setRow(row, (composed >> row * MATRIX_COLUMNS) & ROW_MASK);
+      shown = (shown & ~mask) | (composed & mask);
+      --rows;
+    }
   }
 }
 
-int Display::getFrameRow(int row) {
-  int frameRow = (frame.image >> row * MATRIX_ROWS) & 0xFF;
-  if (frame.clocked && !clock.active) frameRow = frameRow & frame.image;
-  return frameRow;
+uint64_t Display::compose() {
+  if (booting) return getBootFrame();
+  if (frame.active) return getFrame();
+  uint64_t image = pattern | indicators;
+  uint64_t mask = cursor;
+  if (activeTrack.active) {
+    uint64_t rows = TRACK_ROWS_MASK << row(activeTrack.track) * MATRIX_COLUMNS;
+    image &= ~rows;
+    mask = (mask & ~rows) | (flashState ? rows : 0);
+  }
+  return image ^ mask;
+}
+
+uint64_t Display::getFrame() {
+  return frame.clocked && !clock.active ? 0 : frame.image;
+}
+
+uint64_t Display::getBootFrame() {
+  uint64_t image = 0;
+  unsigned long index = (millis() - bootStart) / BOOT_FRAME_TIME;
+  if (index >= BOOT_FRAMES) booting = false;
+  else memcpy_P(&image, index % 2 ? &SMILE : &INVERSE_SMILE, MATRIX_ROWS);
+  return image;
 }
 
 void Display::updateFlashState() {
@@ -77,39 +126,35 @@ void Display::updateFrame() {
 }
 
 void Display::updateCursors() {
-  clear(cursorMask);
-  for (int cursor = 0; cursor < CURSORS; ++cursor) updateCursorMask(cursor);
-}
-
-void Display::updateCursorMask(int cursor) {
-    if(cursors[cursor].active) {
-      bitWrite(cursorMask[cursors[cursor].row].state, cursors[cursor].position, flashState);
+  cursor = 0;
+  if (flashState) {
+    for (int index = 0; index < CURSORS; ++index) {
+      if (cursors[index].active) cursor |= led(cursors[index].row, cursors[index].position);
     }
+  }
 }
 
 void Display::updateIndicators() {
-  updateIndicator(clock);
-  updateIndicator(reset);
-  for(int track = 0; track <= TRACKS; ++track) updateIndicator(tracks[track]);
+  updateIndicator(clock, INDICATOR_TIME);
+  updateIndicator(reset, INDICATOR_TIME);
+  updateIndicator(overrun, OVERRUN_INDICATOR_TIME);
+  for(int track = 0; track <= TRACKS; ++track) updateIndicator(tracks[track], INDICATOR_TIME);
   updateTrackIndicator(activeTrack);
 }
 
-void Display::updateIndicator(Indicator& indicator) {
+void Display::updateIndicator(Indicator& indicator, unsigned long time) {
   if (indicator.active) {
-    if (indicator.start == 0 || (millis() - indicator.start > INDICATOR_TIME)) {
+    if (indicator.start == 0 || (millis() - indicator.start > time)) {
       indicator.active = false;
       indicator.start = 0;
     }
-    setLed(indicator.row, indicator.column, indicator.active);
+    if (indicator.active) indicators |= led(indicator.row, indicator.column);
+    else indicators &= ~led(indicator.row, indicator.column);
   }
 }
 
 void Display::updateTrackIndicator(TrackIndicator& indicator) {
   if (indicator.active) {
-    int row = row(indicator.track);
-    setRows(row, ALL_OFF);
-    cursorMask[row].state = flashState ? ALL_ON : ALL_OFF;
-    cursorMask[row + 1].state = flashState ? ALL_ON : ALL_OFF;
     if (indicator.start == 0 || (millis() - indicator.start > TRACK_INDICATOR_TIME)) {
       indicator.active = false;
       indicator.start = 0;
@@ -169,15 +214,21 @@ void Display::drawLengthView(int track, int length) {
 }
 
 void Display::drawShuffleView(int track, int shuffle) {
-  showFrame(&SHUFFLE[shuffle]);
+  showImage(Glyphs::staircase(shuffle));
 }
 
 void Display::drawPlayModeView(int track, PlayMode mode) {
   showFrame(&PLAY_MODES[mode]);
 }
 
-void Display::drawOutModeView(int track, OutMode mode) {
-  showFrame(&OUT_MODES[mode]);
+void Display::drawOutModeView(int track, OutMode mode, int gateLength) {
+  if (mode == OutMode::Length) {
+    int high = (gateLength + 1) / 2;
+    uint64_t image = Glyphs::block(1, 6, 0x01) | Glyphs::block(1, 1, (1 << high) - 1) | Glyphs::block(1, 6, 1 << (high - 1));
+    showImage(image | Glyphs::block(6, 6, ~((1 << (high - 1)) - 1)));
+  } else {
+    showFrame(&OUT_MODES[mode]);
+  }
 }
 
 void Display::drawPatternTypeView(int track, PatternType mode) {
@@ -192,49 +243,106 @@ void Display::drawDividerView(int track, int divider, DividerType type) {
     case Triplet:
       showFrame(&TRIPLET_DIVIDERS[divider]);
       break;
+    case Ratio:
+      break;
   }
 }
 
+void Display::drawRatioView(int track, int steps, int clocks, bool editSteps) {
+  showImage(ratioBar(1, clocks) | ratioBar(5, steps) | Glyphs::block(editSteps ? 4 : 0, editSteps ? 4 : 0, 0x80));
+}
+
+uint64_t Display::ratioBar(int top, int count) {
+  return Glyphs::block(top, top, (1 << (count > 8 ? 8 : count)) - 1) | Glyphs::block(top + 1, top + 1, count > 8 ? (1 << (count - 8)) - 1 : 0);
+}
+
 void Display::drawDividerTypeView(int track, DividerType type) {
   showFrame(&DIVIDER_TYPES[type]);
 }
 
 void Display::drawMutationView(int track, int mutation) {
-  showFrame(&MUTATION_CHANCE[mutation]);
+  showImage(Glyphs::triangle(mutation));
 }
 
 void Display::drawMutationSeedView(int track, MutationSeed seed) {
   showFrame(&MUTATION_SEEDS[seed]);
 }
 
+void Display::drawQuantiseView(int track, bool quantise) {
+  showFrame(&QUANTISE_MODES[quantise]);
+}
+
+void Display::drawResetView(ResetMode mode) {
+  showFrame(&RESET_MODES[mode]);
+}
+
+void Display::drawSyncView(SyncRole role) {
+  showFrame(&SYNC_ROLES[role]);
+}
+
+void Display::drawGrooveView(byte offsets[]) {
+  uint64_t image = 0;
+  for (int step = 0; step < GROOVE_STEPS; ++step) {
+    int height = (offsets[step] * GROOVE_ROWS + GROOVE_SCALE - 1) / GROOVE_SCALE;
+    int bottom = (step / MATRIX_COLUMNS + 1) * GROOVE_ROWS - 1;
+    for (int row = 0; row < height; ++row) image |= led(bottom - row, step % MATRIX_COLUMNS);
+  }
+  showImage(image);
+}
+
 void Display::drawClockSpeed(bool state) {
   if(state) showClockedFrame(&CLOCK_STATE[state]);
   else showFrame(&CLOCK_STATE[state]);
 }
 
 void Display::drawClockWidth(int width) {
-  showFrame(&CLOCK_WIDTH[width]);
+  showImage(unpack(&CLOCK_WIDTH, CLOCK_WIDTH_DELTAS, width));
 }
 
-void Display::drawOffbeatOutput(bool offBeat) {
-  showFrame(&OFFBEAT_OUTPUT[offBeat]);
+void Display::drawOffbeatOutput(bool offBeat, Logic logic) {
+  if (offBeat && logic != Logic::Inverse) showImage(truthTable(logic));
+  else showFrame(&OFFBEAT_OUTPUT[offBeat]);
 }
 
-void Display::setRows(int row, int state) {
-  setRow(row, lowByte(state));
-  setRow(row + 1, highByte(state));
+void Display::drawPresetView(int slot) {
+  int row = (slot / PRESET_COLUMNS) * 2;
+  int column = (slot % PRESET_COLUMNS) * 2;
+  showImage(PRESET_CELL << (row * MATRIX_COLUMNS + column));
+}
+
+void Display::drawRepeatsView(int repeats) {
+  showImage(~0ULL >> (64 - repeats * 4));
+}
+
+void Display::drawChainView(uint64_t chain) {
+  showImage(chain);
+}
+
+void Display::drawStepView(int step, int probability, int condition, int ratchet) {
+  uint64_t image = led(row(0), 0) << step;
+  image |= (uint64_t)((1UL << probability) - 1) << (row(1) * MATRIX_COLUMNS);
+  image |= (uint64_t)((1UL << condition) - 1) << (row(2) * MATRIX_COLUMNS);
+  image |= (uint64_t)((1 << ratchet) - 1) << (INDICATOR_ROW * MATRIX_COLUMNS);
+  showImage(image);
 }
 
-void Display::setLed(int row, int column, bool state) {
-  bitWrite(display[row].state, column, state);
+void Display::setRows(int row, int state) {
+  int shift = row * MATRIX_COLUMNS;
+  pattern = (pattern & ~(TRACK_ROWS_MASK << shift)) | ((uint64_t)(state & TRACK_ROWS_MASK) << shift);
 }
 
 void Display::setRow(int row, byte state) {
-  display[row].state = state;
+  int shift = row * MATRIX_COLUMNS;
+  pattern = (pattern & ~(ROW_MASK << shift)) | ((uint64_t)state << shift);
+}
+
+uint64_t Display::led(int row, int column) {
+  return 1ULL << (row * MATRIX_COLUMNS + column);
 }
 
 void Display::clear() {
-  clear(display);
+  pattern = 0;
+  indicators = 0;
   timeout();
 }
 
@@ -242,12 +350,6 @@ void Display::timeout() {
   frame.active = false;
 }
 
-void Display::clear(DisplayRow rows[]) {
-  for (int row = 0; row < MATRIX_ROWS; ++row) {
-    rows[row].state = ALL_OFF;
-  }
-}
-
 void Display::indicateClock() {
   showIndicator(clock);
 }
@@ -256,6 +358,10 @@ void Display::indicateReset() {
   showIndicator(reset);
 }
 
+void Display::indicateOverrun() {
+  showIndicator(overrun);
+}
+
 void Display::indicateTrack(int track) {
   showIndicator(tracks[track]);
 }
@@ -291,6 +397,36 @@ void Display::showFrame(const uint64_t *image, unsigned long time, bool clocked)
   frame.clocked = clocked;
 }
 
+void Display::showImage(uint64_t image) {
+  frame.image = image;
+  frame.time = UNLIMITED;
+  frame.start = millis();
+  frame.active = true;
+  frame.clocked = false;
+}
+
+uint64_t Display::truthTable(Logic logic) {
+  uint64_t image = 0;
+  for (int a = 0; a < 2; ++a) {
+    for (int b = 0; b < 2; ++b) {
+      if (Tracks::combine(logic, a, b)) image |= Glyphs::block(a * 4, a * 4 + 2, 0x07 << (b * 4));
+      else image |= Glyphs::block(a * 4 + 1, a * 4 + 1, 0x02 << (b * 4));
+    }
+  }
+  return image;
+}
+
+uint64_t Display::unpack(const uint64_t *image, const uint8_t *deltas, int index) {
+  uint64_t unpacked;
+  memcpy_P(&unpacked, image, MATRIX_ROWS);
+  while (index > 0) {
+    uint8_t delta = pgm_read_byte(deltas++);
+    if (!(delta & DELTA_NONE)) unpacked ^= 1ULL << (delta & DELTA_BIT);
+    if (!(delta & DELTA_MORE)) --index;
+  }
+  return unpacked;
+}
+
 void Display::indicateMode(int mode) {
   byte state = 0;
   bitSet(state, mode);
@@ -317,19 +453,3 @@ void Display::setRange(int &value, int start, int end, int bit) {
     bitWrite(value, i, bit);
   }
 }
-
-void Display::simley() {
-  for (int repeat = 0; repeat < 3; ++ repeat) {
-    showFrame(&INVERSE_SMILE);
-    render();
-    delay(100);
-    showFrame(&SMILE);
-    render();
-    delay(100);
-  }
-  showFrame(&INVERSE_SMILE);
-  render();
-  delay(100);
-  clear();
-  render();
-}
@@ -1,10 +1,10 @@
 #ifndef Display_h_
 #define Display_h_
 
-#include "HardwareInterface.h"
+#include "Glyphs.h"
+#include "Io.h"
 #include "Matrix.h"
 #include "Tracks.h"
-#include <LedControl.h>
 #include <stdint.h>
 
 const uint64_t MODES[] PROGMEM = {
@@ -12,8 +12,8 @@ const uint64_t MODES[] PROGMEM = {
   0x0002001818001818,   // Track Mode
   0x0004001818006666,   // Modifiers Mode
   0x0008006666006666,   // Clock Mode
-  0x001000666600dbdb,   // Reset Mode
-  0x002000dbdb00dbdb    // System Mode
+  0x001000666600dbdb,   // Preset Mode
+  0x002000dbdb00dbdb    // Step Mode
 };
 
 const uint64_t PLAY_MODES[] PROGMEM = {
@@ -31,28 +31,29 @@ const uint64_t OUT_MODES[] PROGMEM = {
 
 const uint64_t DIVIDER_TYPES[] PROGMEM = {
   0x00060e0c08683818,   // Beat
-  0x031bdad292929ce0    // Triplet
+  0x031bdad292929ce0,   // Triplet
+  0x00c2c40810234300    // Ratio
 };
 
-const uint64_t BEAT_DIVIDERS[] PROGMEM {
-  0x0000000008000000,   // Divider 1
-  0x0000000018000000,   // Divider 2
-  0x0000001818000000,   // Divider 4
-  0x0000181818180000,   // Divider 8
-  0x00003c3c3c3c0000,   // Divider 16
-  0x3c3c3c3c3c3c3c3c,   // Divider 32
-  0xffffffffffffffff    // Divider 64
+constexpr uint64_t BEAT_DIVIDERS[] PROGMEM {
+  Glyphs::block(3, 3, 0x08),   // Divider 1
+  Glyphs::block(3, 3, 0x18),   // Divider 2
+  Glyphs::block(3, 4, 0x18),   // Divider 4
+  Glyphs::block(2, 5, 0x18),   // Divider 8
+  Glyphs::block(2, 5, 0x3c),   // Divider 16
+  Glyphs::block(0, 7, 0x3c),   // Divider 32
+  Glyphs::block(0, 7, 0xff)    // Divider 64
 };
 
-const uint64_t TRIPLET_DIVIDERS[] PROGMEM {
-  0x000000001c000000,   // Divider 3
-  0x0000001c1c000000,   // Divider 6
-  0x0000001c1c1c0000,   // Divider 9
-  0x00001c1c1c1c0000,   // Divider 12
-  0x001c1c1c1c1c0000,   // Divider 15
-  0x001c1c1c1c1c1c00,   // Divider 18
-  0x1c1c1c1c1c1c1c00,   // Divider 21
-  0x1c1c1c1c1c1c1c1c    // Divider 24
+constexpr uint64_t TRIPLET_DIVIDERS[] PROGMEM {
+  Glyphs::block(3, 3, 0x1c),   // Divider 3
+  Glyphs::block(3, 4, 0x1c),   // Divider 6
+  Glyphs::block(2, 4, 0x1c),   // Divider 9
+  Glyphs::block(2, 5, 0x1c),   // Divider 12
+  Glyphs::block(2, 6, 0x1c),   // Divider 15
+  Glyphs::block(1, 6, 0x1c),   // Divider 18
+  Glyphs::block(1, 7, 0x1c),   // Divider 21
+  Glyphs::block(0, 7, 0x1c)    // Divider 24
 };
 
 const uint64_t MUTATION_SEEDS[] PROGMEM = {
@@ -61,103 +62,38 @@ const uint64_t MUTATION_SEEDS[] PROGMEM = {
   0x003c18181818183c    // I (Inverse Current)
 };
 
-const uint64_t PATTERN_MODES[] PROGMEM = {
-  0x0006063e6666663e,   // P (Programmed)
-  0x007e06063e06067e    // E (Euclidean)
+const uint64_t QUANTISE_MODES[] PROGMEM = {
+  0x003c18181818183c,   // I (Immediate)
+  0x00603c766666663c    // Q (Quantised)
+};
+
+const uint64_t RESET_MODES[] PROGMEM = {
+  0x003c18181818183c,   // I (Immediate)
+  0x003c66060606663c,   // C (Next Clock)
+  0x003e66663e66663e    // B (Next Bar)
 };
 
-const uint64_t SHUFFLE[] PROGMEM = {
-  0x0000000000000000,
-  0x0000000000000001,
-  0x0000000000000101,
-  0x0000000000000301,
-  0x0000000000020301,
-  0x0000000000060301,
-  0x0000000004060301,
-  0x000000000c060301,
-  0x000000080c060301,
-  0x000000180c060301,
-  0x000010180c060301,
-  0x000030180c060301,
-  0x002030180c060301,
-  0x006030180c060301,
-  0x406030180c060301,
-  0xc06030180c060301
+const uint64_t SYNC_ROLES[] PROGMEM = {
+  0x003c66666666663c,   // O (Alone)
+  0x007e060606060606,   // L (Leader)
+  0x000606063e06067e    // F (Follower)
 };
 
-const uint64_t MUTATION_CHANCE[] PROGMEM = {
-  0x0000000000000000,
-  0x0100000000000000,
-  0x0300000000000000,
-  0x0302000000000000,
-  0x0702000000000000,
-  0x0706000000000000,
-  0x0706040000000000,
-  0x0f06040000000000,
-  0x0f0e040000000000,
-  0x0f0e0c0000000000,
-  0x0f0e0c0800000000,
-  0x1f0e0c0800000000,
-  0x1f1e0c0800000000,
-  0x1f1e1c0800000000,
-  0x1f1e1c1800000000,
-  0x1f1e1c1810000000,
-  0x3f1e1c1810000000,
-  0x3f3e1c1810000000,
-  0x3f3e3c1810000000,
-  0x3f3e3c3810000000,
-  0x3f3e3c3830000000,
-  0x3f3e3c3830200000,
-  0x7f3e3c3830200000,
-  0x7f7e3c3830200000,
-  0x7f7e7c3830200000,
-  0x7f7e7c7830200000,
-  0x7f7e7c7870200000,
-  0x7f7e7c7870600000,
-  0x7f7e7c7870604000,
-  0xff7e7c7870604000,
-  0xfffe7c7870604000,
-  0xfffefc7870604000,
-  0xfffefcf870604000,
-  0xfffefcf8f0604000,
-  0xfffefcf8f0e04000,
-  0xfffefcf8f0e0c000,
-  0xfffefcf8f0e0c080,
-  0xfffefcf8f0e0c080
+const uint64_t PATTERN_MODES[] PROGMEM = {
+  0x0006063e6666663e,   // P (Programmed)
+  0x007e06063e06067e,   // E (Euclidean)
+  0x001818181818187e,   // T (Turing)
+  0x006666667e66663c    // A (Automaton)
 };
 
-const uint64_t CLOCK_WIDTH[] PROGMEM = {
-  0x00ff020202020200,
-  0x00ff020202020600,
-  0x00ff020202060600,
-  0x00ff020206060600,
-  0x00ff020606060600,
-  0x00ff060606060600,
-  0x00ff060606060e00,
-  0x00ff0606060a0e00,
-  0x00ff06060a0a0e00,
-  0x00ff060a0a0a0e00,
-  0x00ff0a0a0a0a0e00,
-  0x00fb0a0a0a0a0e00,
-  0x00fb0a0a0a0a1e00,
-  0x00fb0a0a0a121e00,
-  0x00fb0a0a12121e00,
-  0x00fb0a1212121e00,
-  0x00fb121212121e00,
-  0x00f3121212121e00,
-  0x00f3121212123e00,
-  0x00f3121212223e00,
-  0x00f3121222223e00,
-  0x00f3122222223e00,
-  0x00f3222222223e00,
-  0x00e3222222223e00,
-  0x00e3222222223e00,
-  0x00e3222222227e00,
-  0x00e3222222427e00,
-  0x00e3222242427e00,
-  0x00e3224242427e00,
-  0x00e3424242427e00,
-  0x00c3424242427e00
+const uint64_t CLOCK_WIDTH PROGMEM = 0x00ff020202020200;
+
+constexpr uint8_t CLOCK_WIDTH_DELTAS[] PROGMEM = {
+  0x0a, 0x12, 0x1a, 0x22, 0x2a,
+  0x0b, 0x92, 0x13, 0x9a, 0x1b, 0xa2, 0x23, 0xaa, 0x2b, 0x32,
+  0x0c, 0x93, 0x14, 0x9b, 0x1c, 0xa3, 0x24, 0xab, 0x2c, 0x33,
+  0x0d, 0x94, 0x15, 0x9c, 0x1d, 0xa4, 0x25, 0xac, 0x2d, 0x34, 0x40,
+  0x0e, 0x95, 0x16, 0x9d, 0x1e, 0xa5, 0x26, 0xad, 0x2e, 0x35
 };
 
 const uint64_t CLOCK_STATE[] PROGMEM = {
@@ -173,6 +109,20 @@ const uint64_t OFFBEAT_OUTPUT[] PROGMEM = {
 const uint64_t SMILE PROGMEM = 0x003c420024242400;
 const uint64_t INVERSE_SMILE PROGMEM = 0xffc3bdffdbdbdbff;
 
+#define SHUFFLE_FRAMES 16
+#define MUTATION_FRAMES 38
+#define CLOCK_WIDTH_FRAMES 31
+
+constexpr uint64_t clockWidth(int index) {
+  return Glyphs::unpack(CLOCK_WIDTH, CLOCK_WIDTH_DELTAS, index);
+}
+
+static_assert(Glyphs::checksum(BEAT_DIVIDERS, 7) == 0x5a44f1ba416f4b43ULL, "Beat divider glyphs changed");
+static_assert(Glyphs::checksum(TRIPLET_DIVIDERS, 8) == 0xf29e61c96aec9c1cULL, "Triplet divider glyphs changed");
+static_assert(Glyphs::checksum(Glyphs::staircase, SHUFFLE_FRAMES) == 0x73ad530388e6a521ULL, "Shuffle glyphs changed");
+static_assert(Glyphs::checksum(Glyphs::triangle, MUTATION_FRAMES) == 0x09a624f996789000ULL, "Mutation glyphs changed");
+static_assert(Glyphs::checksum(clockWidth, CLOCK_WIDTH_FRAMES) == 0x4f0bb265c573fa00ULL, "Clock width glyphs changed");
+
 struct DisplayFrame {
   uint64_t image;
   unsigned long time;
@@ -181,10 +131,6 @@ struct DisplayFrame {
   bool clocked;
 };
 
-struct DisplayRow {
-  byte state = 0;
-};
-
 struct Indicator {
   int row;
   int column;
@@ -204,13 +150,14 @@ struct Cursor {
   bool active = false;
 };
 
-class Display : public HardwareInterface {
+class Display {
 public:
   Display();
-  virtual void initialise();
+  void initialise();
   void clear();
   void timeout();
   void render();
+  bool isDue();
   void drawProgrammedView(int track, int pattern);
   void drawEuclideanView(int track, int pattern);
   void drawOffsetView(int track, int pattern);
@@ -218,56 +165,76 @@ public:
   void drawShuffleView(int track, int length);
   void drawLengthView(int track, int start, int end, bool active);
   void drawPlayModeView(int track, PlayMode mode);
-  void drawOutModeView(int track, OutMode mode);
+  void drawOutModeView(int track, OutMode mode, int gateLength);
   void drawPlayView(int track, int position, int pattern, bool cursor);
   void drawDividerView(int track, int divider, DividerType type);
   void drawDividerTypeView(int track, DividerType type);
+  void drawRatioView(int track, int steps, int clocks, bool editSteps);
   void drawPatternTypeView(int track, PatternType mode);
   void drawMutationView(int track, int mutation);
   void drawMutationSeedView(int track, MutationSeed seed);
+  void drawQuantiseView(int track, bool quantise);
+  void drawResetView(ResetMode mode);
+  void drawSyncView(SyncRole role);
+  void drawGrooveView(byte offsets[]);
   void drawClockSpeed(bool state);
   void drawClockWidth(int width);
-  void drawOffbeatOutput(bool offBeat);
+  void drawOffbeatOutput(bool offBeat, Logic logic);
+  void drawPresetView(int slot);
+  void drawRepeatsView(int repeats);
+  void drawChainView(uint64_t chain);
+  void drawStepView(int step, int probability, int condition, int ratchet);
   void setTrackCursor(int track, int position);
   void indicateReset();
+  void indicateOverrun();
   void indicateClock();
   void indicateTrack(int track);
   void indicateActiveTrack(int track);
   void indicateMode(int mode);
 private:
+  void refresh();
+  void flush(int rows);
   void updateFlashState();
   void showCursor(int track, bool visible);
-  void clear(DisplayRow rows[]);
   void showIndicator(Indicator& indicator);
   void updateIndicators();
-  void updateIndicator(Indicator& indicator);
+  void updateIndicator(Indicator& indicator, unsigned long time);
   void updateTrackIndicator(TrackIndicator& indicator);
   bool hasCursorMoved();
   void updateCursors();
   void updateFrame();
-  int getFrameRow(int row);
-  void updateCursorMask(int cursor);
-  void simley();
-  void showSmileyFace();
-  void showInverseSmileyFace();
+  uint64_t compose();
+  uint64_t getFrame();
+  uint64_t getBootFrame();
+  uint64_t led(int row, int column);
+  uint64_t ratioBar(int top, int count);
   void fill(int &value, int length, int bit);
   void setRange(int &value, int start, int end, int bit);
   void setRow(int row, byte state);
   void setRows(int row, int state);
-  void setLed(int row, int column, bool state);
   void showFrame(const uint64_t *image);
   void showClockedFrame(const uint64_t *image);
   void showTimedFrame(const uint64_t *image, unsigned long time);
   void showFrame(const uint64_t *image, unsigned long time, bool clocked);
-  DisplayRow display[8];
-  DisplayRow cursorMask[8];
+  void showImage(uint64_t image);
+  uint64_t unpack(const uint64_t *image, const uint8_t *deltas, int index);
+  uint64_t truthTable(Logic logic);
+  uint64_t pattern = 0;
+  uint64_t cursor = 0;
+  uint64_t indicators = 0;
+  uint64_t composed = 0;
+  uint64_t shown = 0;
+  unsigned long refreshTime = 0;
+  unsigned long bootStart = 0;
+  bool booting = false;
   DisplayFrame frame;
   Cursor cursors[3];
   Indicator clock;
   Indicator reset;
+  Indicator overrun;
   Indicator tracks[4];
   TrackIndicator activeTrack;
-  Matrix matrix = Matrix();
+  Matrix<2, 3, 4> matrix;
   unsigned long cursorTime = 0;
   bool flashState = true;
 };
@@ -6,53 +6,114 @@
 #define TWO_B 10
 #define THREE_A 5
 #define THREE_B 6
+#define ENCODERS 3
+#define COUNTS_PER_DETENT 2
+#define QUEUE_SIZE 16
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+#define EVENT_CONTROL 0x03
+#define EVENT_INCREMENT 0x04
+#define EVENT_SPEED_SHIFT 3
+#define FAST_TURN 8
+#define MEDIUM_TURN 16
+#define SLOW_TURN 32
+
+const byte PINS[ENCODERS][2] = {{ONE_A, ONE_B}, {TWO_A, TWO_B}, {THREE_A, THREE_B}};
+const int8_t QUADRATURE[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+const int SPEEDS[4] = {1, 2, 4, 8};
+
+volatile byte Encoders::queue[QUEUE_SIZE];
+volatile byte Encoders::head = 0;
+volatile byte Encoders::tail = 0;
+byte Encoders::states[ENCODERS];
+int Encoders::counts[ENCODERS];
+unsigned long Encoders::times[ENCODERS];
+
+#if defined(__AVR__)
+ISR(PCINT0_vect) {
+  Encoders::decode();
+}
+
+ISR(PCINT2_vect) {
+  Encoders::decode();
+}
+#endif
 
 Encoders::Encoders(bool reverse)
-  : one(ONE_A, ONE_B), two(TWO_A, TWO_B), three(THREE_A, THREE_B), reversed(reverse) {
+  : reversed(reverse) {
 }
 
 void Encoders::initialise() {
-  digitalWrite(ONE_A, HIGH);
-  digitalWrite(ONE_B, HIGH);
-  digitalWrite(TWO_A, HIGH);
-  digitalWrite(TWO_B, HIGH);
-  digitalWrite(THREE_A, HIGH);
-  digitalWrite(THREE_B, HIGH);
+  Pin<ONE_A>::pullup();
+  Pin<ONE_B>::pullup();
+  Pin<TWO_A>::pullup();
+  Pin<TWO_B>::pullup();
+  Pin<THREE_A>::pullup();
+  Pin<THREE_B>::pullup();
+  for (int encoder = 0; encoder < ENCODERS; ++encoder) {
+#if defined(__AVR__)
+    for (int pin = 0; pin < 2; ++pin) {
+      *digitalPinToPCICR(PINS[encoder][pin]) |= _BV(digitalPinToPCICRbit(PINS[encoder][pin]));
+      *digitalPinToPCMSK(PINS[encoder][pin]) |= _BV(digitalPinToPCMSKbit(PINS[encoder][pin]));
+    }
+#endif
+    states[encoder] = read(encoder);
+  }
 }
 
 EncoderEvent Encoders::event() {
-  EncoderEvent event = EncoderEvent{Control::NoControl, EncoderState::Stopped};
-
-  EncoderState state = read(one);
-  if (state != EncoderState::Stopped) {
-    event.control = Control::One;
-    event.state = state;
-  } else {
-    state = read(two);
-    if (state != EncoderState::Stopped) {
-        event.control = Control::Two;
-        event.state = state;
-    } else {
-      state = read(three);
-      if (state != EncoderState::Stopped) {
-          event.control = Control::Three;
-          event.state = state;
-      }
-    }
+  EncoderEvent event = EncoderEvent{Control::NoControl, EncoderState::Stopped, 1};
+  if (tail != head) {
+    byte entry = queue[tail];
+    tail = (tail + 1) & QUEUE_MASK;
+    bool increment = (entry & EVENT_INCREMENT) != reversed;
+    event.control = (Control)(entry & EVENT_CONTROL);
+    event.state = increment ? EncoderState::Increment : EncoderState::Decrement;
+    event.speed = SPEEDS[entry >> EVENT_SPEED_SHIFT];
   }
   return event;
 }
 
-EncoderState Encoders::read(Encoder &encoder) {
-  EncoderState result = EncoderState::Stopped;
-  int reading = encoder.read();
-  if (reading < EncoderState::Decrement) {
-    result = !reversed ?  EncoderState::Decrement : EncoderState::Increment;
-    encoder.write(EncoderState::Stopped);
+void Encoders::decode() {
+  for (int encoder = 0; encoder < ENCODERS; ++encoder) decode(encoder, read(encoder));
+}
+
+void Encoders::decode(int encoder, byte pins) {
+  if (pins == states[encoder]) return;
+  counts[encoder] += QUADRATURE[(states[encoder] << 2) | pins];
+  states[encoder] = pins;
+  if (counts[encoder] >= COUNTS_PER_DETENT) {
+    counts[encoder] = 0;
+    push(encoder, true);
+  } else if (counts[encoder] <= -COUNTS_PER_DETENT) {
+    counts[encoder] = 0;
+    push(encoder, false);
+  }
+}
+
+void Encoders::push(int encoder, bool increment) {
+  unsigned long now = millis();
+  unsigned long interval = now - times[encoder];
+  times[encoder] = now;
+  byte speed = interval < FAST_TURN ? 3 : interval < MEDIUM_TURN ? 2 : interval < SLOW_TURN ? 1 : 0;
+  byte next = (head + 1) & QUEUE_MASK;
+  if (next != tail) {
+    queue[head] = encoder | (increment ? EVENT_INCREMENT : 0) | (speed << EVENT_SPEED_SHIFT);
+    head = next;
   }
-  else if (reading > EncoderState::Increment) {
-    result = !reversed ?  EncoderState::Increment : EncoderState::Decrement;
-    encoder.write(EncoderState::Stopped);
+}
+
+byte Encoders::read(int encoder) {
+  byte pins = 0;
+  switch(encoder) {
+    case 0:
+      pins = (Pin<ONE_A>::read() << 1) | Pin<ONE_B>::read();
+      break;
+    case 1:
+      pins = (Pin<TWO_A>::read() << 1) | Pin<TWO_B>::read();
+      break;
+    case 2:
+      pins = (Pin<THREE_A>::read() << 1) | Pin<THREE_B>::read();
+      break;
   }
-  return (EncoderState) result;
+  return pins;
 }
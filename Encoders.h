@@ -2,7 +2,7 @@
 #define Encoders_h_
 
 #include "Controller.h"
-#include <Encoder.h>
+#include "Pin.h"
 
 enum EncoderState {
   Stopped = 0,
@@ -13,16 +13,25 @@ enum EncoderState {
 struct EncoderEvent {
   Control control;
   EncoderState state;
+  int speed;
 };
 
-class Encoders : public Controller {
+class Encoders {
 public:
   Encoders(bool reverse);
-  virtual void initialise();
+  void initialise();
   EncoderEvent event();
+  static void decode();
 private:
-  Encoder one, two, three;
-  EncoderState read(Encoder& encoder);
+  static void decode(int encoder, byte pins);
+  static void push(int encoder, bool increment);
+  static byte read(int encoder);
+  static volatile byte queue[];
+  static volatile byte head;
+  static volatile byte tail;
+  static byte states[];
+  static int counts[];
+  static unsigned long times[];
   bool reversed;
 };
 
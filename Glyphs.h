@@ -0,0 +1,44 @@
+#ifndef Glyphs_h_
+#define Glyphs_h_
+
+#include <stdint.h>
+
+#define GLYPH_COLUMNS 0x0101010101010101ULL
+#define GLYPH_TRIANGLE 36
+#define DELTA_BIT 0x3F
+#define DELTA_NONE 0x40
+#define DELTA_MORE 0x80
+
+class Glyphs {
+public:
+  static constexpr uint64_t block(int top, int bottom, uint8_t columns) {
+    return bottom < top ? 0 : ((~0ULL >> (56 - 8 * (bottom - top))) << (8 * top)) & (GLYPH_COLUMNS * columns);
+  }
+  static constexpr uint64_t staircase(int count) {
+    return count == 0 ? 0 : 0xc06030180c060301ULL & ((2ULL << (8 * (count / 2) + (count - 1) / 2)) - 1);
+  }
+  static constexpr uint64_t triangle(int count) {
+    return triangle(count < GLYPH_TRIANGLE ? count : GLYPH_TRIANGLE, 0, 0);
+  }
+  static constexpr uint64_t unpack(uint64_t image, const uint8_t *deltas, int index) {
+    return index == 0 ? image : unpack(toggle(image, deltas), skip(deltas), index - 1);
+  }
+  static constexpr uint64_t checksum(uint64_t (*glyph)(int), int count) {
+    return count == 0 ? 0 : checksum(glyph, count - 1) * 31 + glyph(count - 1);
+  }
+  static constexpr uint64_t checksum(const uint64_t *glyphs, int count) {
+    return count == 0 ? 0 : checksum(glyphs, count - 1) * 31 + glyphs[count - 1];
+  }
+private:
+  static constexpr uint64_t triangle(int count, int column, uint64_t image) {
+    return count <= column ? image | block(8 - count, 7, 1 << column) : triangle(count - column - 1, column + 1, image | block(7 - column, 7, 1 << column));
+  }
+  static constexpr uint64_t toggle(uint64_t image, const uint8_t *deltas) {
+    return *deltas & DELTA_NONE ? image : (*deltas & DELTA_MORE ? toggle(image, deltas + 1) : image) ^ (1ULL << (*deltas & DELTA_BIT));
+  }
+  static constexpr const uint8_t *skip(const uint8_t *deltas) {
+    return *deltas & DELTA_MORE ? skip(deltas + 1) : deltas + 1;
+  }
+};
+
+#endif
@@ -1,10 +0,0 @@
-#ifndef HardwareInterface_h_
-#define HardwareInterface_h_
-
-class HardwareInterface {
-public:
-  virtual void initialise() = 0;
-private:
-};
-
-#endif
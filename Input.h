@@ -2,16 +2,58 @@
 #define Input_h_
 
 #include "Io.h"
-#include "HardwareInterface.h"
+#include "Pin.h"
+#include <Arduino.h>
 
-class Input : public HardwareInterface {
+#define HYSTERIA 100
+#define ANALOG_PIN_OFFSET 14
+
+template<uint8_t PIN>
+class Input {
 public:
-  Input(int io);
-  virtual void initialise();
-  Signal signal();
+  void initialise() {
+    pinMode(PIN, INPUT);
+  }
+  Signal signal() {
+    Signal current = Signal::Low;
+    int reading = analogRead(PIN);
+    switch(previous) {
+      case Low:
+      case Falling:
+        if(reading > HYSTERIA) current = Signal::Rising;
+        break;
+      case High:
+      case Rising:
+        if(reading > HYSTERIA) current = Signal::High;
+        else if(reading < HYSTERIA) current = Signal::Falling;
+        break;
+    }
+    previous = current;
+    return current;
+  }
+  void initialiseLatch() {
+#if defined(__AVR__)
+    *digitalPinToPCICR(ANALOG_PIN_OFFSET + PIN) |= _BV(digitalPinToPCICRbit(ANALOG_PIN_OFFSET + PIN));
+    *digitalPinToPCMSK(ANALOG_PIN_OFFSET + PIN) |= _BV(digitalPinToPCMSKbit(ANALOG_PIN_OFFSET + PIN));
+#endif
+    level = Pin<ANALOG_PIN_OFFSET + PIN>::read();
+  }
+  void latch() {
+    bool high = Pin<ANALOG_PIN_OFFSET + PIN>::read();
+    if (high && !level) edge = true;
+    level = high;
+  }
+  bool isLatched() {
+    noInterrupts();
+    bool latched = edge;
+    edge = false;
+    interrupts();
+    return latched;
+  }
 private:
-  int pin;
-  Signal previous;
+  Signal previous = Signal::Low;
+  volatile bool level = false;
+  volatile bool edge = false;
 };
 
 #endif
@@ -1,8 +1,6 @@
 #ifndef Io_h_
 #define Io_h_
 
-#include "HardwareInterface.h"
-
 enum Signal {
   Low = 0,
   High = 1,
@@ -10,4 +8,16 @@ enum Signal {
   Falling = 3
 };
 
+enum ResetMode {
+  Immediate = 0,
+  NextClock = 1,
+  NextBar = 2
+};
+
+enum SyncRole {
+  Alone = 0,
+  Leader = 1,
+  Follower = 2
+};
+
 #endif
@@ -1,18 +1,52 @@
 #ifndef Matrix_h_
 #define Matrix_h_
 
-#include "HardwareInterface.h"
-#include <LedControl.h>
+#include "Pin.h"
 
-class Matrix : public HardwareInterface {
+#define OP_DIGIT0 1
+#define OP_DECODEMODE 9
+#define OP_INTENSITY 10
+#define OP_SCANLIMIT 11
+#define OP_SHUTDOWN 12
+#define OP_DISPLAYTEST 15
+#define MATRIX_DIGITS 8
+
+template<uint8_t DATA, uint8_t CLOCK, uint8_t LOAD>
+class Matrix {
 public:
-  Matrix();
-  virtual void initialise();
-  void clear();
-  void setLed(int row, int column, bool state);
-  void setRow(int row, byte state);
+  void initialise() {
+    Pin<DATA>::output();
+    Pin<CLOCK>::output();
+    Pin<LOAD>::output();
+    Pin<LOAD>::write(HIGH);
+    transfer(OP_DISPLAYTEST, 0);
+    transfer(OP_SCANLIMIT, MATRIX_DIGITS - 1);
+    transfer(OP_DECODEMODE, 0);
+    transfer(OP_INTENSITY, 0);
+    transfer(OP_SHUTDOWN, 0);
+    clear();
+    transfer(OP_SHUTDOWN, 1);
+  }
+  void clear() {
+    for (int row = 0; row < MATRIX_DIGITS; ++row) setRow(row, 0);
+  }
+  void setRow(int row, byte state) {
+    transfer(OP_DIGIT0 + row, state);
+  }
 private:
-  LedControl matrix;
+  void transfer(byte address, byte value) {
+    Pin<LOAD>::write(LOW);
+    shift(address);
+    shift(value);
+    Pin<LOAD>::write(HIGH);
+  }
+  void shift(byte value) {
+    for (int bit = 7; bit >= 0; --bit) {
+      Pin<DATA>::write(bitRead(value, bit));
+      Pin<CLOCK>::write(HIGH);
+      Pin<CLOCK>::write(LOW);
+    }
+  }
 };
 
 #endif
@@ -0,0 +1,60 @@
+#include "Monitor.h"
+
+#define CLOCK_PIN 14
+#define EDGES_IN_FLIGHT 1
+
+volatile unsigned long Monitor::edges = 0;
+volatile bool Monitor::level = false;
+
+Monitor::Monitor()
+  : processed(0), missed(0), passStart(0), longest(0), overruns(0) {
+}
+
+void Monitor::initialise() {
+#if defined(__AVR__)
+  *digitalPinToPCICR(CLOCK_PIN) |= _BV(digitalPinToPCICRbit(CLOCK_PIN));
+  *digitalPinToPCMSK(CLOCK_PIN) |= _BV(digitalPinToPCMSKbit(CLOCK_PIN));
+#endif
+  level = Pin<CLOCK_PIN>::read();
+  passStart = micros();
+}
+
+void Monitor::count() {
+  bool high = Pin<CLOCK_PIN>::read();
+  if (high && !level) ++edges;
+  level = high;
+}
+
+bool Monitor::pass(unsigned long period) {
+  unsigned long now = micros();
+  unsigned long duration = now - passStart;
+  passStart = now;
+  if (duration > longest) longest = duration;
+  unsigned long behind = getEdges() - processed;
+  bool dropped = behind > missed + EDGES_IN_FLIGHT;
+  if (dropped) missed = behind - EDGES_IN_FLIGHT;
+  bool overrun = dropped || (period > 0 && duration > period * 1000);
+  if (overrun) ++overruns;
+  return overrun;
+}
+
+void Monitor::process() {
+  ++processed;
+}
+
+void Monitor::sync() {
+  processed = getEdges() - missed;
+}
+
+MonitorCounters Monitor::read() {
+  MonitorCounters counters = MonitorCounters{getEdges(), processed, missed, longest, overruns};
+  longest = 0;
+  return counters;
+}
+
+unsigned long Monitor::getEdges() {
+  noInterrupts();
+  unsigned long count = edges;
+  interrupts();
+  return count;
+}
@@ -0,0 +1,34 @@
+#ifndef Monitor_h_
+#define Monitor_h_
+
+#include "Pin.h"
+
+struct MonitorCounters {
+  unsigned long edges;
+  unsigned long processed;
+  unsigned long missed;
+  unsigned long longest;
+  unsigned int overruns;
+};
+
+class Monitor {
+public:
+  Monitor();
+  void initialise();
+  bool pass(unsigned long period);
+  void process();
+  void sync();
+  MonitorCounters read();
+  static void count();
+private:
+  static volatile unsigned long edges;
+  static volatile bool level;
+  unsigned long processed;
+  unsigned long missed;
+  unsigned long passStart;
+  unsigned long longest;
+  unsigned int overruns;
+  unsigned long getEdges();
+};
+
+#endif
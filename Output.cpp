@@ -3,12 +3,8 @@
 
 #define TRIGGER_PULSE 20
 
-Output::Output(int io)
- : pin(io), triggerStart(0) {
-}
-
-void Output::initialise() {
-		pinMode(pin, OUTPUT);
+Output::Output()
+ : triggerStart(0) {
 }
 
 int Output::signal(Signal signal, OutMode mode, int step) {
@@ -18,13 +14,13 @@ int Output::signal(Signal signal, OutMode mode, int step) {
 			if (step) out = handleTrigger(signal);
 		  break;
 		case Gate:
+		case Length:
 			if (step) out = HIGH;
 		  break;
 		case Clock:
 		  if (step && (signal == Signal::Rising || signal == Signal::High)) out = HIGH;
 			break;
 	}
-	digitalWrite(pin, out);
 	return out;
 }
 
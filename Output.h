@@ -1,19 +1,107 @@
 #ifndef Output_h_
 #define Output_h_
 
-#include "HardwareInterface.h"
 #include "Io.h"
+#include "Pin.h"
+#include "Timer.h"
 #include "Tracks.h"
 
-class Output : public HardwareInterface {
+#define OUTPUTS 4
+#define PULSE_IDLE 0x7FFF
+#define PULSE_WIDTHS 16
+
+struct Pulse {
+  uint16_t due;
+  uint16_t high;
+  uint16_t low;
+  byte edges;
+  bool held;
+};
+
+class Output {
 public:
-  Output(int io);
-  virtual void initialise();
+  Output();
   int signal(Signal signal, OutMode mode, int step);
 private:
-  int pin;
   unsigned long triggerStart;
   int handleTrigger(Signal signal);
 };
 
+template<uint8_t ONE, uint8_t TWO, uint8_t THREE, uint8_t FOUR>
+class Outputs {
+public:
+  void initialise() {
+    Pin<ONE>::output();
+    Pin<TWO>::output();
+    Pin<THREE>::output();
+    Pin<FOUR>::output();
+    Timer::initialise();
+  }
+  int signal(int output, Signal signal, OutMode mode, int step) {
+    int out = outputs[output].signal(signal, mode, step);
+    if (signal == Signal::Rising) {
+      pulses[output].edges = 0;
+      pulses[output].held = false;
+    }
+    if (!pulses[output].held) write(output, out);
+    return out;
+  }
+  void pulse(int output, int count, unsigned long period, int width) {
+    uint16_t interval = Timer::ticks(period) / count;
+    uint16_t high = ((unsigned long)interval * width) / PULSE_WIDTHS;
+    if (high > 0) {
+      noInterrupts();
+      pulses[output].high = high;
+      pulses[output].low = interval - high;
+      pulses[output].due = Timer::now() + high;
+      pulses[output].edges = count * 2 - 1;
+      pulses[output].held = true;
+      write(output, HIGH);
+      schedule();
+      interrupts();
+    }
+  }
+  void fire() {
+    uint16_t now = Timer::now();
+    for (int output = 0; output < OUTPUTS; ++output) {
+      volatile Pulse &pulse = pulses[output];
+      if (pulse.edges > 0 && (int16_t)(pulse.due - now) <= 0) {
+        --pulse.edges;
+        write(output, pulse.edges & 1);
+        pulse.due += pulse.edges & 1 ? pulse.high : pulse.low;
+      }
+    }
+    schedule();
+  }
+private:
+  Output outputs[OUTPUTS];
+  volatile Pulse pulses[OUTPUTS];
+  void schedule() {
+    uint16_t now = Timer::now();
+    int16_t next = PULSE_IDLE;
+    for (int output = 0; output < OUTPUTS; ++output) {
+      int16_t wait = pulses[output].due - now;
+      if (pulses[output].edges > 0 && wait < next) next = wait;
+    }
+    if (next == PULSE_IDLE) Timer::cancel();
+    else Timer::schedule(now + (next > 0 ? next : 1));
+  }
+  void write(int output, int out) {
+    switch(output) {
+      case 0:
+        Pin<ONE>::write(out);
+        break;
+      case 1:
+        Pin<TWO>::write(out);
+        break;
+      case 2:
+        Pin<THREE>::write(out);
+        break;
+      case 3:
+        Pin<FOUR>::write(out);
+        break;
+    }
+  }
+};
+
 #endif
@@ -0,0 +1,25 @@
+#include "Packer.h"
+
+Packer::Packer(byte *buffer)
+  : data(buffer), position(0) {
+}
+
+void Packer::write(unsigned long value, int bits) {
+  for (int bit = 0; bit < bits; ++bit) {
+    bitWrite(data[position >> 3], position & 7, bitRead(value, bit));
+    ++position;
+  }
+}
+
+unsigned long Packer::read(int bits) {
+  unsigned long value = 0;
+  for (int bit = 0; bit < bits; ++bit) {
+    if (bitRead(data[position >> 3], position & 7)) value |= 1UL << bit;
+    ++position;
+  }
+  return value;
+}
+
+int Packer::size() {
+  return (position + 7) >> 3;
+}
@@ -0,0 +1,17 @@
+#ifndef Packer_h_
+#define Packer_h_
+
+#include <Arduino.h>
+
+class Packer {
+public:
+  Packer(byte *buffer);
+  void write(unsigned long value, int bits);
+  unsigned long read(int bits);
+  int size();
+private:
+  byte *data;
+  int position;
+};
+
+#endif
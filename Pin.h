@@ -0,0 +1,60 @@
+#ifndef Pin_h_
+#define Pin_h_
+
+#include <Arduino.h>
+
+template<uint8_t PIN>
+class Pin {
+public:
+#if defined(__AVR__)
+  static void output() {
+    if (PIN < 8) DDRD |= MASK;
+    else if (PIN < 14) DDRB |= MASK;
+    else DDRC |= MASK;
+  }
+  static void pullup() {
+    if (PIN < 8) {
+      DDRD &= ~MASK;
+      PORTD |= MASK;
+    } else if (PIN < 14) {
+      DDRB &= ~MASK;
+      PORTB |= MASK;
+    } else {
+      DDRC &= ~MASK;
+      PORTC |= MASK;
+    }
+  }
+  static bool read() {
+    return (PIN < 8 ? PIND : PIN < 14 ? PINB : PINC) & MASK;
+  }
+  static void write(bool high) {
+    if (PIN < 8) {
+      if (high) PORTD |= MASK;
+      else PORTD &= ~MASK;
+    } else if (PIN < 14) {
+      if (high) PORTB |= MASK;
+      else PORTB &= ~MASK;
+    } else {
+      if (high) PORTC |= MASK;
+      else PORTC &= ~MASK;
+    }
+  }
+private:
+  static const uint8_t MASK = 1 << (PIN < 8 ? PIN : PIN < 14 ? PIN - 8 : PIN - 14);
+#else
+  static void output() {
+    pinMode(PIN, OUTPUT);
+  }
+  static void pullup() {
+    pinMode(PIN, INPUT_PULLUP);
+  }
+  static bool read() {
+    return digitalRead(PIN);
+  }
+  static void write(bool high) {
+    digitalWrite(PIN, high);
+  }
+#endif
+};
+
+#endif
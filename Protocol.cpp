@@ -0,0 +1,212 @@
+#include "Protocol.h"
+#include "Utilities.h"
+
+#define PROTOCOL_BAUD 115200
+#define PROTOCOL_SYNC 0xA5
+#define PROTOCOL_BATCH 16
+#define PROTOCOL_REPLY 0x80
+#define PROTOCOL_ERROR 0x7F
+#define TRACKS 3
+#define SYNC_PAYLOAD 4
+
+Protocol::Protocol(Tracks &tracks, ClockGenerator &clock, Monitor &monitor, Benchmark &benchmark, Sync &sync)
+  : tracks(tracks), clock(clock), monitor(monitor), benchmark(benchmark), sync(sync), parse(ParseState::AwaitSync), received(0), crc(0), replyLength(0) {
+}
+
+void Protocol::initialise() {
+  Serial.begin(PROTOCOL_BAUD);
+}
+
+void Protocol::poll() {
+  for (int count = 0; count < PROTOCOL_BATCH && replyLength == 0 && Serial.available() > 0; ++count) receive(Serial.read());
+  if (replyLength > 0 && Serial.availableForWrite() >= replyLength) {
+    Serial.write(reply, replyLength);
+    replyLength = 0;
+  }
+  if (sync.isPingDue(millis())) {
+    byte data[2];
+    send(SyncPing, data, pack(data, Timer::now(), 2));
+  }
+}
+
+void Protocol::sendClock(unsigned long ticks) {
+  byte data[SYNC_PAYLOAD];
+  send(SyncClock, data, pack(data, ticks, SYNC_PAYLOAD));
+}
+
+void Protocol::sendReset(ResetMode mode) {
+  byte data = mode;
+  send(SyncReset, &data, 1);
+}
+
+void Protocol::sendStop() {
+  send(SyncStop, NULL, 0);
+}
+
+void Protocol::receive(byte value) {
+  switch(parse) {
+    case AwaitSync:
+      if (value == PROTOCOL_SYNC) parse = ParseState::AwaitCommand;
+      break;
+    case AwaitCommand:
+      frame[0] = value;
+      parse = ParseState::AwaitLength;
+      break;
+    case AwaitLength:
+      frame[1] = value;
+      received = 0;
+      if (value > FRAME_PAYLOAD) parse = ParseState::AwaitSync;
+      else parse = value == 0 ? ParseState::AwaitCrcLow : ParseState::AwaitPayload;
+      break;
+    case AwaitPayload:
+      frame[2 + received] = value;
+      ++received;
+      if (received >= frame[1]) parse = ParseState::AwaitCrcLow;
+      break;
+    case AwaitCrcLow:
+      crc = value;
+      parse = ParseState::AwaitCrcHigh;
+      break;
+    case AwaitCrcHigh:
+      crc |= (uint16_t)value << 8;
+      if (crc == Utilities::crc16(frame, frame[1] + 2)) handle();
+      parse = ParseState::AwaitSync;
+      break;
+  }
+}
+
+void Protocol::handle() {
+  byte command = frame[0];
+  int length = frame[1];
+  byte *payload = &frame[2];
+  byte data[FRAME_PAYLOAD] = {0};
+  switch(command) {
+    case GetTracks:
+      respond(command, data, tracks.getTracks(data));
+      break;
+    case SetTracks:
+      acknowledge(command, tracks.setTracks(payload, length));
+      break;
+    case GetPatterns:
+      for (int track = 0; track < TRACKS; ++track) {
+        data[track * 2] = lowByte(tracks.getPatternWord(track));
+        data[track * 2 + 1] = highByte(tracks.getPatternWord(track));
+      }
+      respond(command, data, TRACKS * 2);
+      break;
+    case SetPatterns:
+      if (length == TRACKS * 2) {
+        for (int track = 0; track < TRACKS; ++track) tracks.setPatternWord(track, payload[track * 2] | (payload[track * 2 + 1] << 8));
+      }
+      acknowledge(command, length == TRACKS * 2);
+      break;
+    case GetClock:
+      data[0] = clock.getSpeed();
+      data[1] = clock.getWidth();
+      data[2] = clock.getMulitplier();
+      data[3] = clock.isRunning();
+      respond(command, data, 4);
+      break;
+    case SetClock:
+      if (length == 4) {
+        clock.setSpeed(payload[0] - clock.getSpeed());
+        clock.setWidth(payload[1] - clock.getWidth());
+        clock.setMulitplier(payload[2] - clock.getMulitplier());
+        if (payload[3] && !clock.isRunning()) clock.start();
+        else if (!payload[3] && clock.isRunning()) clock.stop();
+      }
+      acknowledge(command, length == 4);
+      break;
+    case GetMonitor: {
+      MonitorCounters counters = monitor.read();
+      int size = pack(data, counters.edges, 4);
+      size += pack(&data[size], counters.processed, 4);
+      size += pack(&data[size], counters.missed, 4);
+      size += pack(&data[size], counters.longest, 4);
+      size += pack(&data[size], counters.overruns, 2);
+      respond(command, data, size);
+      break;
+    }
+    case StartBenchmark:
+      if (length == 2 && (payload[0] | payload[1])) benchmark.start(payload[0] | (payload[1] << 8));
+      else if (length == 2) benchmark.stop();
+      acknowledge(command, length == 2);
+      break;
+    case GetBenchmark: {
+      BenchmarkResult result = benchmark.read();
+      int size = pack(data, result.running, 1);
+      size += pack(&data[size], result.period, 2);
+      size += pack(&data[size], result.generated, 2);
+      size += pack(&data[size], result.processed, 2);
+      size += pack(&data[size], result.lost, 2);
+      size += pack(&data[size], result.longest, 2);
+      for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) data[size++] = result.latencies[bucket];
+      respond(command, data, size);
+      break;
+    }
+    case GetGroove:
+      if (length == 1 && payload[0] < GROOVES) {
+        for (int step = 0; step < GROOVE_STEPS; ++step) data[step] = tracks.getGrooveOffset(payload[0], step);
+        respond(command, data, GROOVE_STEPS);
+      } else {
+        acknowledge(command, false);
+      }
+      break;
+    case SetGroove:
+      acknowledge(command, length == GROOVE_STEPS + 1 && tracks.storeGroove(payload[0], &payload[1], GROOVE_STEPS));
+      break;
+    case SyncClock:
+      if (length == SYNC_PAYLOAD) sync.receive((unsigned long)payload[0] | ((unsigned long)payload[1] << 8) | ((unsigned long)payload[2] << 16) | ((unsigned long)payload[3] << 24), Timer::now());
+      break;
+    case SyncReset:
+      if (length == 1 && payload[0] <= ResetMode::NextBar) sync.receiveReset((ResetMode) payload[0]);
+      break;
+    case SyncStop:
+      if (length == 0) sync.receiveStop();
+      break;
+    case SyncPing:
+      respond(command, payload, length);
+      break;
+    case SyncPing | PROTOCOL_REPLY:
+      if (length == 2) sync.measure(payload[0] | (payload[1] << 8), Timer::now());
+      break;
+    case SetSync:
+      if (length == 1) sync.setRole(payload[0] - sync.getRole());
+      acknowledge(command, length == 1 && payload[0] <= SyncRole::Follower);
+      break;
+    default:
+      if (!(command & PROTOCOL_REPLY)) acknowledge(command, false);
+      break;
+  }
+}
+
+void Protocol::acknowledge(byte command, bool success) {
+  byte status = success ? 0 : PROTOCOL_ERROR;
+  respond(command, &status, 1);
+}
+
+int Protocol::pack(byte data[], unsigned long value, int bytes) {
+  for (int index = 0; index < bytes; ++index) data[index] = (value >> (8 * index)) & 0xFF;
+  return bytes;
+}
+
+void Protocol::respond(byte command, byte payload[], int length) {
+  replyLength = build(reply, command | PROTOCOL_REPLY, payload, length);
+}
+
+void Protocol::send(byte command, byte payload[], int length) {
+  byte message[SYNC_PAYLOAD + 5];
+  int size = build(message, command, payload, length);
+  if (Serial.availableForWrite() >= size) Serial.write(message, size);
+}
+
+int Protocol::build(byte message[], byte command, byte payload[], int length) {
+  message[0] = PROTOCOL_SYNC;
+  message[1] = command;
+  message[2] = length;
+  for (int index = 0; index < length; ++index) message[3 + index] = payload[index];
+  uint16_t check = Utilities::crc16(&message[1], length + 2);
+  message[3 + length] = lowByte(check);
+  message[4 + length] = highByte(check);
+  return length + 5;
+}
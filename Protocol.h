@@ -0,0 +1,70 @@
+#ifndef Protocol_h_
+#define Protocol_h_
+
+#include "Tracks.h"
+#include "ClockGenerator.h"
+#include "Monitor.h"
+#include "Benchmark.h"
+#include "Sync.h"
+#include <Arduino.h>
+
+#define FRAME_PAYLOAD 48
+
+enum ProtocolCommand {
+  GetTracks = 1,
+  SetTracks = 2,
+  GetPatterns = 3,
+  SetPatterns = 4,
+  GetClock = 5,
+  SetClock = 6,
+  GetMonitor = 7,
+  StartBenchmark = 8,
+  GetBenchmark = 9,
+  GetGroove = 10,
+  SetGroove = 11,
+  SyncClock = 12,
+  SyncReset = 13,
+  SyncPing = 14,
+  SetSync = 15,
+  SyncStop = 16
+};
+
+enum ParseState {
+  AwaitSync,
+  AwaitCommand,
+  AwaitLength,
+  AwaitPayload,
+  AwaitCrcLow,
+  AwaitCrcHigh
+};
+
+class Protocol {
+public:
+  Protocol(Tracks &tracks, ClockGenerator &clock, Monitor &monitor, Benchmark &benchmark, Sync &sync);
+  void initialise();
+  void poll();
+  void sendClock(unsigned long ticks);
+  void sendReset(ResetMode mode);
+  void sendStop();
+private:
+  Tracks &tracks;
+  ClockGenerator &clock;
+  Monitor &monitor;
+  Benchmark &benchmark;
+  Sync &sync;
+  ParseState parse;
+  byte frame[FRAME_PAYLOAD + 2];
+  int received;
+  uint16_t crc;
+  byte reply[FRAME_PAYLOAD + 5];
+  int replyLength;
+  void receive(byte value);
+  void handle();
+  void respond(byte command, byte payload[], int length);
+  void send(byte command, byte payload[], int length);
+  int build(byte message[], byte command, byte payload[], int length);
+  void acknowledge(byte command, bool success);
+  int pack(byte data[], unsigned long value, int bytes);
+};
+
+#endif
@@ -1,13 +1,8 @@
 #include "Shuffle.h"
-#include "Utilities.h"
 #include <Arduino.h>
 
-#define shuffleDelay(g,s) (g/96L) * s * 2L
-
-#define BEATS 16
-
 Shuffle::Shuffle()
- : gate(0), beat(0), state{0, Signal::Low, {Signal::Low, Signal::Low, Signal::Low, Signal::Low}, {false, false, false, false}} {
+ : gate(0), state{0, 0, Signal::Low, {Signal::Low, Signal::Low, Signal::Low, Signal::Low}, {0, 0, 0, 0}, {0, 0, 0, 0}, {false, false, false, false}, {false, false, false, false}} {
 }
 
 void Shuffle::clock(Signal signal) {
@@ -15,38 +10,52 @@ void Shuffle::clock(Signal signal) {
   if (signal == Signal::Rising) {
     gate = now - state.lastClock;
     state.lastClock = now;
-    ++beat;
-    Utilities::cycle(beat, 0, BEATS - 1);
-    newCycle();
+  } else if (signal == Signal::Low && state.clockSignal != Signal::Low) {
+    state.width = now - state.lastClock;
   }
   state.clockSignal = signal;
 }
 
-Signal Shuffle::tick(int track, int shuffle) {
-  Signal signal;
-  if(shuffle == 0 || gate == 0 || beat % 2 == 0) signal = state.clockSignal;
-  else  signal = shuffleClock(track, shuffle);
+void Shuffle::delay(int track, unsigned long delay) {
+  state.start[track] = state.lastClock;
+  state.release[track] = delay;
+  state.pending[track] = delay > 0;
+  state.held[track] = false;
+}
+
+Signal Shuffle::tick(int track) {
+  Signal signal = state.clockSignal;
+  if (state.pending[track]) signal = release(track);
+  else if (state.held[track]) signal = hold(track);
   state.shuffleSignal[track] = signal;
   return signal;
 }
 
-void Shuffle::newCycle() {
-  for(int track = 0; track < 4; ++track) state.newCycle[track] = true;
+bool Shuffle::isDelayed(int track) {
+  return state.pending[track] || state.held[track];
 }
 
-void Shuffle::reset() {
-  beat = 0;
+unsigned long Shuffle::getPeriod() {
+  return gate;
 }
 
-Signal Shuffle::shuffleClock(int track, int shuffle) {
+Signal Shuffle::release(int track) {
   Signal signal = Signal::Low;
-  if (!state.newCycle[track]) {
-    signal = state.clockSignal;
-  } else if ((millis() - state.lastClock) > shuffleDelay(gate, shuffle)) {
-    if (state.shuffleSignal[track] == Signal::Low) {
-      signal = Signal::Rising;
-      state.newCycle[track] = false;
-    }
+  unsigned long now = millis();
+  if ((now - state.start[track]) > state.release[track] && state.shuffleSignal[track] == Signal::Low) {
+    signal = Signal::Rising;
+    state.start[track] = now;
+    state.pending[track] = false;
+    state.held[track] = true;
+  }
+  return signal;
+}
+
+Signal Shuffle::hold(int track) {
+  Signal signal = Signal::High;
+  if (millis() - state.start[track] >= state.width) {
+    signal = Signal::Low;
+    state.held[track] = false;
   }
   return signal;
 }
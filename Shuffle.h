@@ -3,27 +3,31 @@
 
 #include "Shuffle.h"
 #include "Io.h"
-#include <Encoder.h>
 
 struct ShuffleState {
   unsigned long lastClock;
+  unsigned long width;
   Signal clockSignal;
   Signal shuffleSignal[4];
-  bool newCycle[4];
+  unsigned long start[4];
+  unsigned long release[4];
+  bool pending[4];
+  bool held[4];
 };
 
 class Shuffle {
 public:
   Shuffle();
   void clock(Signal signal);
-  Signal tick(int track, int shuffle);
-  void reset();
+  void delay(int track, unsigned long delay);
+  Signal tick(int track);
+  bool isDelayed(int track);
+  unsigned long getPeriod();
 private:
   unsigned long gate;
-  int beat;
   ShuffleState state;
-  Signal shuffleClock(int track, int shuffle);
-  void newCycle();
+  Signal release(int track);
+  Signal hold(int track);
 };
 
 #endif
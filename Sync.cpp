@@ -0,0 +1,95 @@
+#include "Sync.h"
+#include "Utilities.h"
+
+#define SYNC_PING_INTERVAL 500
+#define SYNC_SMOOTHING 4
+
+Sync::Sync()
+  : role(SyncRole::Alone), resetMode(ResetMode::Immediate), received(0), lastPing(0), edge(0), next(0), local(0), period(0), latency(0), pending(false), armed(false), measured(false), resetLatched(false), stopped(false) {
+}
+
+void Sync::setRole(int offset) {
+  int value = role + offset;
+  Utilities::bound(value, SyncRole::Alone, SyncRole::Follower);
+  role = (SyncRole) value;
+  period = 0;
+  armed = false;
+  pending = false;
+  stopped = false;
+}
+
+SyncRole Sync::getRole() {
+  return role;
+}
+
+void Sync::receive(unsigned long ticks, uint16_t arrival) {
+  if (role != SyncRole::Follower) return;
+  uint16_t at = arrival - latency;
+  uint16_t sample = at - edge;
+  if (stopped || received == 0 || ticks != received + 1 || sample > MAX_TIMER_TICKS) period = 0;
+  else if (period == 0) period = sample;
+  else period += (int16_t)(sample - period) / SYNC_SMOOTHING;
+  edge = at;
+  received = ticks;
+  pending = true;
+  stopped = false;
+}
+
+void Sync::receiveReset(ResetMode mode) {
+  if (role != SyncRole::Follower) return;
+  resetMode = mode;
+  resetLatched = true;
+}
+
+void Sync::receiveStop() {
+  if (role != SyncRole::Follower) return;
+  armed = false;
+  stopped = true;
+}
+
+void Sync::measure(uint16_t sent, uint16_t arrival) {
+  uint16_t half = (uint16_t)(arrival - sent) / 2;
+  if (!measured) latency = half;
+  else latency += (int16_t)(half - latency) / SYNC_SMOOTHING;
+  measured = true;
+}
+
+bool Sync::isPingDue(unsigned long now) {
+  if (role != SyncRole::Follower || now - lastPing < SYNC_PING_INTERVAL) return false;
+  lastPing = now;
+  return true;
+}
+
+bool Sync::isResetLatched() {
+  bool latched = resetLatched;
+  resetLatched = false;
+  return latched;
+}
+
+ResetMode Sync::getResetMode() {
+  return resetMode;
+}
+
+uint16_t Sync::getLatency() {
+  return latency;
+}
+
+Signal Sync::follow(Tracks &tracks) {
+  Signal signal = Signal::Low;
+  uint16_t now = Timer::now();
+  if (pending) {
+    pending = false;
+    if (received == tracks.getTicks() + 1) signal = Signal::Rising;
+    else if (received != tracks.getTicks()) tracks.seek(received);
+    next = edge + period;
+    armed = period > 0 && !stopped;
+  } else if (armed && (int16_t)(now - next) >= 0) {
+    armed = false;
+    signal = Signal::Rising;
+  } else if (tracks.getTicks() == received + 1 && (stopped || (uint16_t)(now - next) > period / 2)) {
+    tracks.seek(received);
+  }
+  if (signal == Signal::Rising) local = now;
+  else if (period > 0 && (uint16_t)(now - local) < period / 2) signal = Signal::High;
+  return signal;
+}
@@ -0,0 +1,39 @@
+#ifndef Sync_h_
+#define Sync_h_
+
+#include "Io.h"
+#include "Timer.h"
+#include "Tracks.h"
+
+class Sync {
+public:
+  Sync();
+  void setRole(int offset);
+  SyncRole getRole();
+  void receive(unsigned long ticks, uint16_t arrival);
+  void receiveReset(ResetMode mode);
+  void receiveStop();
+  void measure(uint16_t sent, uint16_t arrival);
+  bool isPingDue(unsigned long now);
+  bool isResetLatched();
+  ResetMode getResetMode();
+  uint16_t getLatency();
+  Signal follow(Tracks &tracks);
+private:
+  SyncRole role;
+  ResetMode resetMode;
+  unsigned long received;
+  unsigned long lastPing;
+  uint16_t edge;
+  uint16_t next;
+  uint16_t local;
+  uint16_t period;
+  uint16_t latency;
+  bool pending;
+  bool armed;
+  bool measured;
+  bool resetLatched;
+  bool stopped;
+};
+
+#endif
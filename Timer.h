@@ -0,0 +1,53 @@
+#ifndef Timer_h_
+#define Timer_h_
+
+#include <Arduino.h>
+
+#define TIMER_PRESCALER 1024
+#define TIMER_TICKS_PER_SECOND (F_CPU / TIMER_PRESCALER)
+#define MAX_TIMER_TICKS 0x7FFF
+
+class Timer {
+public:
+  static uint16_t ticks(unsigned long ms) {
+    unsigned long ticks = (ms * TIMER_TICKS_PER_SECOND) / 1000;
+    return ticks > MAX_TIMER_TICKS ? MAX_TIMER_TICKS : ticks;
+  }
+#if defined(__AVR__)
+  static void initialise() {
+    TCCR1A = 0;
+    TCCR1B = _BV(CS12) | _BV(CS10);
+    TIMSK1 = 0;
+  }
+  static uint16_t now() {
+    return TCNT1;
+  }
+  static void schedule(uint16_t at) {
+    OCR1A = at;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+  }
+  static void cancel() {
+    TIMSK1 &= ~_BV(OCIE1A);
+  }
+  static void scheduleB(uint16_t at) {
+    OCR1B = at;
+    TIFR1 = _BV(OCF1B);
+    TIMSK1 |= _BV(OCIE1B);
+  }
+  static void cancelB() {
+    TIMSK1 &= ~_BV(OCIE1B);
+  }
+#else
+  static void initialise() {}
+  static uint16_t now() {
+    return micros() / (1000000UL / TIMER_TICKS_PER_SECOND);
+  }
+  static void schedule(uint16_t at) {}
+  static void cancel() {}
+  static void scheduleB(uint16_t at) {}
+  static void cancelB() {}
+#endif
+};
+
+#endif
@@ -3,17 +3,76 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 
-#define CONFIG_VERSION 105
+#define CONFIG_VERSION 113
 #define CONFIG_ADDRESS 0
+#define CONFIG_MAGIC 0x4D
+#define PACKED_VERSION 107
+#define CHAIN_VERSION 108
+#define STEP_VERSION 109
+#define RATCHET_VERSION 110
+#define GATE_VERSION 111
+#define GROOVE_VERSION 112
+#define RATIO_VERSION 113
+#define QUANTISE_VERSION 106
+#define LEGACY_VERSION 105
+#define SETTINGS_SIZE 128
+#define PRESET_ADDRESS 256
+#define GROOVE_ADDRESS 160
+#define CHAIN_SLOT_MASK 0x0F
+#define CHAIN_REPEAT_SHIFT 4
 #define MAX_STEP_INDEX 15
 #define MAX_BEAT_DIVIDER 6
 #define MAX_TRIPLET_DIVIDER 7
+#define MAX_RATIO_DIVIDER 0
+#define MAX_RATIO 16
+#define RATIO_BITS 4
+#define LEGACY_RATIO_CLOCKS 0
+#define LEGACY_RATIO_STEPS 1
 #define MAX_SHUFFLE MAX_STEP_INDEX
 #define MAX_MUTATION 37
 #define MUTATION_FACTOR 100
+#define TURING_CHANCE 8
+#define NIBBLE_MASK 0x0F
+#define MAX_CHANCE 16
+#define MAX_CONDITION 15
+#define CONDITION_FIRST 1
+#define CONDITION_NOT_FIRST 2
+#define MAX_RATCHET 8
+#define RATCHET_BITS 3
+#define MAX_GATE_LENGTH 15
+#define MAX_GROOVE (GROOVES - 1)
+#define GROOVE_BITS 4
+#define GROOVE_DIVISIONS 96
+#define MAX_GROOVE_OFFSET 47
 #define TRACKS 3
 
+const byte RULES[] PROGMEM = {30, 45, 73, 90, 105, 110, 150, 18, 22, 54, 57, 60, 62, 126, 169, 225};
+
+const byte LEGACY_RATIOS[][2] PROGMEM = {
+  {3, 2},
+  {4, 3},
+  {5, 4},
+  {5, 3},
+  {7, 4},
+  {7, 5},
+  {8, 5},
+  {8, 7}
+};
+
+const byte GROOVE_OFFSETS[BUILT_IN_GROOVES][GROOVE_STEPS] PROGMEM = {
+  {0, 30, 0, 30, 0, 30, 0, 30, 0, 30, 0, 30, 0, 30, 0, 30},
+  {0, 0, 30, 0, 0, 0, 30, 0, 0, 0, 30, 0, 0, 0, 30, 0},
+  {0, 32, 0, 32, 0, 32, 0, 32, 0, 32, 0, 32, 0, 32, 0, 32},
+  {0, 24, 0, 36, 0, 24, 0, 36, 0, 24, 0, 36, 0, 24, 0, 36},
+  {0, 18, 6, 30, 0, 14, 8, 26, 0, 18, 6, 30, 0, 14, 8, 26},
+  {0, 6, 2, 8, 0, 4, 2, 10, 0, 6, 2, 8, 0, 4, 2, 12},
+  {0, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 12, 0, 0, 0},
+  {0, 3, 6, 9, 12, 15, 18, 21, 24, 21, 18, 15, 12, 9, 6, 3}
+};
+
 Tracks::Tracks() {
+  seed = random(0x7FFFFFFF);
+  setLogic(Logic::Inverse, 0, 1);
   load();
   reset();
 }
@@ -51,7 +110,7 @@ void Tracks::setLength(int track, int offset) {
   tracks[track].length += offset;
   Utilities::bound(tracks[track].length, 0, MAX_STEP_INDEX);
   Utilities::bound(tracks[track].offset, 0, tracks[track].length);
-  Utilities::bound(tracks[track].density, 0, tracks[track].length);
+  Utilities::bound(tracks[track].density, 0, maxDensity(tracks[track]));
   resetLength(track);
   resetPattern(track);
   change = true;
@@ -59,8 +118,9 @@ void Tracks::setLength(int track, int offset) {
 
 void Tracks::setDensity(int track, int offset) {
   tracks[track].density += offset;
-  Utilities::bound(tracks[track].density, 0, tracks[track].length);
-  resetPattern(track);
+  Utilities::bound(tracks[track].density, 0, maxDensity(tracks[track]));
+  if (tracks[track].patternType != PatternType::Turing) resetPattern(track);
+  else if (!state[track].pending) state[track].prepared = false;
   change = true;
 }
 
@@ -74,8 +134,9 @@ void Tracks::setOffset(int track, int offset) {
 void Tracks::nextPatternType(int track) {
   int mode = (int)tracks[track].patternType;
   ++mode;
-  Utilities::cycle(mode, PatternType::Programmed, PatternType::Euclidean);
+  Utilities::cycle(mode, PatternType::Programmed, PatternType::Automaton);
   tracks[track].patternType = (PatternType) mode;
+  Utilities::bound(tracks[track].density, 0, maxDensity(tracks[track]));
   resetLength(track);
   resetPattern(track);
   change = true;
@@ -86,21 +147,23 @@ void Tracks::setPlayMode(int track, int offset) {
   mode += offset;
   Utilities::cycle(mode, PlayMode::Forward, PlayMode::Random);
   tracks[track].play = (PlayMode) mode;
-  state[track].forward = true;
+  resetPhase(track);
   change = true;
 }
 
 void Tracks::setOutMode(int track, int offset) {
   int mode = (int) tracks[track].out;
+  if (tracks[track].out == OutMode::Length) mode += tracks[track].gateLength;
   mode += offset;
-  Utilities::cycle(mode, OutMode::Trigger, OutMode::Gate);
-  tracks[track].out = (OutMode) mode;
+  Utilities::bound(mode, OutMode::Trigger, OutMode::Length + MAX_GATE_LENGTH);
+  tracks[track].out = mode < OutMode::Length ? (OutMode) mode : OutMode::Length;
+  if (mode >= OutMode::Length) tracks[track].gateLength = mode - OutMode::Length;
   change = true;
 }
 
 void Tracks::setDivider(int track, int offset) {
   tracks[track].divider += offset;
-  Utilities::bound(tracks[track].divider, 0, tracks[track].dividerType == DividerType::Beat ? MAX_BEAT_DIVIDER : MAX_TRIPLET_DIVIDER);
+  Utilities::bound(tracks[track].divider, 0, maxDivider(tracks[track].dividerType));
   resetDivision(track);
   change = true;
 }
@@ -108,21 +171,42 @@ void Tracks::setDivider(int track, int offset) {
 void Tracks::nextDividerType(int track) {
   int mode = (int)tracks[track].dividerType;
   ++mode;
-  Utilities::cycle(mode, DividerType::Beat, DividerType::Triplet);
+  Utilities::cycle(mode, DividerType::Beat, DividerType::Ratio);
   tracks[track].dividerType = (DividerType) mode;
   resetDivision(track);
   change = true;
 }
 
+void Tracks::setRatioSteps(int track, int offset) {
+  tracks[track].ratioSteps += offset;
+  Utilities::bound(tracks[track].ratioSteps, 1, tracks[track].ratioClocks);
+  resetDivision(track);
+  change = true;
+}
+
+void Tracks::setRatioClocks(int track, int offset) {
+  tracks[track].ratioClocks += offset;
+  Utilities::bound(tracks[track].ratioClocks, tracks[track].ratioSteps, MAX_RATIO);
+  resetDivision(track);
+  change = true;
+}
+
 void Tracks::setShuffle(int track, int offset) {
   tracks[track].shuffle += offset;
   Utilities::bound(tracks[track].shuffle, 0, MAX_SHUFFLE);
   change = true;
 }
 
+void Tracks::setGroove(int track, int offset) {
+  tracks[track].groove += offset;
+  Utilities::bound(tracks[track].groove, 0, MAX_GROOVE);
+  change = true;
+}
+
 void Tracks::setMutation(int track, int offset) {
   tracks[track].mutation += offset;
   Utilities::bound(tracks[track].mutation, 0, MAX_MUTATION);
+  if (!state[track].pending) state[track].prepared = false;
   change = true;
 }
 
@@ -131,9 +215,49 @@ void Tracks::nextMutationSeed(int track) {
   ++mode;
   Utilities::cycle(mode, MutationSeed::Original, MutationSeed::LastInverted);
   tracks[track].mutationSeed = (MutationSeed) mode;
+  if (!state[track].pending) state[track].prepared = false;
+  change = true;
+}
+
+void Tracks::setQuantise(int track, int offset) {
+  int quantise = tracks[track].quantise;
+  quantise += offset;
+  Utilities::bound(quantise, false, true);
+  tracks[track].quantise = quantise;
+  if (!tracks[track].quantise) commit(track);
   change = true;
 }
 
+void Tracks::appendChain(int track, int slot, int repeats) {
+  Chain &chain = chains[track];
+  if (chain.count < CHAIN_LENGTH) {
+    chain.links[chain.count] = slot | ((repeats - 1) << CHAIN_REPEAT_SHIFT);
+    ++chain.count;
+    if (chain.count == 1) {
+      chain.index = 0;
+      chain.loop = repeats - 1;
+    }
+    change = true;
+  }
+}
+
+void Tracks::removeChain(int track) {
+  Chain &chain = chains[track];
+  if (chain.count > 0) {
+    --chain.count;
+    if (chain.index >= chain.count) {
+      chain.index = 0;
+      chain.loop = 0;
+    }
+    if (chain.prefetched) {
+      state[track].pending = false;
+      state[track].prepared = false;
+      chain.prefetched = false;
+    }
+    change = true;
+  }
+}
+
 int Tracks::getStart(int track) {
   return track < TRACKS ? tracks[track].start : getStart(0);
 }
@@ -143,13 +267,17 @@ int Tracks::getEnd(int track) {
 }
 
 int Tracks::getLength(int track) {
-  return track < TRACKS ? state[track].length : getLength(0);
+  return track < TRACKS ? (state[track].pending ? state[track].nextLength : state[track].length) : getLength(0);
 }
 
 int Tracks::getPattern(int track) {
   return track < TRACKS ? state[track].pattern : getPattern(0);
 }
 
+int Tracks::getEditPattern(int track) {
+  return track < TRACKS ? (state[track].pending ? state[track].next : state[track].pattern) : getEditPattern(0);
+}
+
 int Tracks::getDivider(int track) {
   return track < TRACKS ? tracks[track].divider : getDivider(0);
 }
@@ -158,12 +286,110 @@ DividerType Tracks::getDividerType(int track) {
   return track < TRACKS ? tracks[track].dividerType : getDividerType(0);
 }
 
+int Tracks::getRatioSteps(int track) {
+  return track < TRACKS ? tracks[track].ratioSteps : getRatioSteps(0);
+}
+
+int Tracks::getRatioClocks(int track) {
+  return track < TRACKS ? tracks[track].ratioClocks : getRatioClocks(0);
+}
+
 int Tracks::getPosition(int track) {
   return track < TRACKS ? state[track].position : getPosition(0);
 }
 
 int Tracks::getStep(int track) {
-  return track < TRACKS ? bitRead(state[track].pattern, state[track].position) : !getStep(0);
+  return track < TRACKS ? bitRead(state[track].pattern & state[track].gate, state[track].position) : bitRead(getSteps(), TRACKS);
+}
+
+int Tracks::getProbability(int track, int step) {
+  return MAX_CHANCE - nibble(probabilities[track], step);
+}
+
+int Tracks::getCondition(int track, int step) {
+  return nibble(conditions[track], step);
+}
+
+void Tracks::setProbability(int track, int step, int offset) {
+  int chance = getProbability(track, step) + offset;
+  Utilities::bound(chance, 1, MAX_CHANCE);
+  setNibble(probabilities[track], step, MAX_CHANCE - chance);
+  state[track].gate = gateMask(track, state[track].loops);
+  state[track].armed = false;
+  change = true;
+}
+
+void Tracks::setCondition(int track, int step, int offset) {
+  int condition = getCondition(track, step) + offset;
+  Utilities::bound(condition, 0, MAX_CONDITION);
+  setNibble(conditions[track], step, condition);
+  state[track].gate = gateMask(track, state[track].loops);
+  state[track].armed = false;
+  change = true;
+}
+
+void Tracks::setRatchet(int track, int step, int offset) {
+  int ratchet = getRatchet(track, step) + offset;
+  Utilities::cycle(ratchet, 1, MAX_RATCHET);
+  setNibble(ratchets[track], step, ratchet - 1);
+  change = true;
+}
+
+int Tracks::getRatchet(int track) {
+  return track < TRACKS ? getRatchet(track, state[track].position) : getRatchet(0);
+}
+
+int Tracks::getRatchet(int track, int step) {
+  return nibble(ratchets[track], step) + 1;
+}
+
+void Tracks::clearStep(int track, int step) {
+  setNibble(probabilities[track], step, 0);
+  setNibble(ratchets[track], step, 0);
+  setCondition(track, step, -MAX_CONDITION);
+}
+
+int Tracks::getSteps() {
+  int steps = 0;
+  for(int track = 0; track < TRACKS; ++track) steps |= bitRead(state[track].pattern & state[track].gate, state[track].position) << track;
+  return outputs[steps];
+}
+
+Logic Tracks::getLogic() {
+  return logic;
+}
+
+void Tracks::setLogic(Logic logic, int a, int b) {
+  this->logic = logic;
+  for(int steps = 0; steps < (1 << TRACKS); ++steps) {
+    outputs[steps] = steps;
+    bitWrite(outputs[steps], TRACKS, combine(logic, bitRead(steps, a), bitRead(steps, b)));
+  }
+}
+
+bool Tracks::combine(Logic logic, bool a, bool b) {
+  bool out = false;
+  switch(logic) {
+    case Inverse:
+      out = !a;
+      break;
+    case And:
+      out = a && b;
+      break;
+    case Or:
+      out = a || b;
+      break;
+    case Xor:
+      out = a != b;
+      break;
+    case Nand:
+      out = !(a && b);
+      break;
+    case AndNot:
+      out = a && !b;
+      break;
+  }
+  return out;
 }
 
 PatternType Tracks::getPatternType(int track) {
@@ -178,6 +404,14 @@ OutMode Tracks::getOutMode(int track) {
   return track < TRACKS ? tracks[track].out: getOutMode(0);
 }
 
+int Tracks::getGateLength(int track) {
+  return track < TRACKS ? tracks[track].gateLength + 1 : getGateLength(0);
+}
+
+unsigned long Tracks::getStepPeriod(int track, unsigned long clockPeriod) {
+  return track < TRACKS ? (clockPeriod * state[track].division) / state[track].rate : getStepPeriod(0, clockPeriod);
+}
+
 int Tracks::getShuffle(int track) {
   return track < TRACKS ? tracks[track].shuffle: getShuffle(0);
 }
@@ -186,26 +420,100 @@ int Tracks::getStepped(int track) {
   return track < TRACKS ? state[track].stepped: getStepped(0);
 }
 
+int Tracks::getGroove(int track) {
+  return track < TRACKS ? tracks[track].groove : getGroove(0);
+}
+
+int Tracks::getGrooveOffset(int groove, int step) {
+  if (groove < BUILT_IN_GROOVES) return pgm_read_byte(&GROOVE_OFFSETS[groove][step]);
+  return userGrooves ? EEPROM.read(GROOVE_ADDRESS + sizeof(SettingsHeader) + (groove - BUILT_IN_GROOVES) * GROOVE_STEPS + step) : 0;
+}
+
+unsigned long Tracks::getGrooveDelay(int track, unsigned long clockPeriod) {
+  if (track >= TRACKS) return getGrooveDelay(0, clockPeriod);
+  if (!state[track].stepped || tracks[track].shuffle == 0) return 0;
+  int offset = getGrooveOffset(tracks[track].groove, (state[track].steps - 1) & MAX_STEP_INDEX);
+  unsigned long period = getStepPeriod(track, clockPeriod);
+  unsigned long delay = period * offset * tracks[track].shuffle / (GROOVE_DIVISIONS * MAX_SHUFFLE);
+  unsigned long limit = period * MAX_GROOVE_OFFSET / GROOVE_DIVISIONS;
+  return delay < limit ? delay : limit;
+}
+
+bool Tracks::storeGroove(int groove, byte offsets[], int size) {
+  bool valid = groove >= BUILT_IN_GROOVES && groove <= MAX_GROOVE && size == GROOVE_STEPS;
+  for (int step = 0; valid && step < GROOVE_STEPS; ++step) valid = offsets[step] <= MAX_GROOVE_OFFSET;
+  if (valid) {
+    byte data[USER_GROOVES * GROOVE_STEPS] = {0};
+    for (int index = 0; index < USER_GROOVES * GROOVE_STEPS; ++index) data[index] = getGrooveOffset(BUILT_IN_GROOVES + index / GROOVE_STEPS, index % GROOVE_STEPS);
+    for (int step = 0; step < GROOVE_STEPS; ++step) data[(groove - BUILT_IN_GROOVES) * GROOVE_STEPS + step] = offsets[step];
+    writeRecord(GROOVE_ADDRESS, data, USER_GROOVES * GROOVE_STEPS);
+    userGrooves = true;
+  }
+  return valid;
+}
+
 int Tracks::getMutation(int track) {
   return track < TRACKS ? tracks[track].mutation: getMutation(0);
 }
 
+unsigned long Tracks::getTicks() {
+  return ticks;
+}
+
 MutationSeed Tracks::getMutationSeed(int track){
   return track < TRACKS ? tracks[track].mutationSeed: getMutationSeed(0);
 }
 
+bool Tracks::getQuantise(int track) {
+  return track < TRACKS ? tracks[track].quantise: getQuantise(0);
+}
+
+uint64_t Tracks::getChain(int track) {
+  uint64_t chain = 0;
+  for (int link = 0; link < chains[track].count; ++link) chain |= (uint64_t)chains[track].links[link] << (link * 8);
+  return chain;
+}
+
 void Tracks::stepOn() {
+  if (presetRecalled) applyPreset();
+  ++ticks;
   for(int track = 0; track < TRACKS; ++track) stepOn(track);
 }
 
+void Tracks::seek(unsigned long tick) {
+  ticks = tick;
+  for(int track = 0; track < TRACKS; ++track) {
+    seekTrack(track);
+    seekChain(track);
+  }
+}
+
+void Tracks::prepare() {
+  for(int track = 0; track < TRACKS; ++track) {
+    if (isChainDue(track) && !presetRecalled) prefetch(track, (chains[track].index + 1) % chains[track].count);
+    else if (!state[track].prepared) prepare(track);
+    if (!state[track].armed) arm(track);
+  }
+}
+
+void Tracks::commit() {
+  if (presetRecalled) applyPreset();
+  for(int track = 0; track < TRACKS; ++track) if (state[track].pending) commit(track);
+}
+
 void Tracks::reset() {
-  for(int track = 0; track < TRACKS; ++track) initialiseState(track);
+  ticks = 0;
+  for(int track = 0; track < TRACKS; ++track) {
+    initialiseState(track);
+    restartChain(track);
+  }
 }
 
 void Tracks::stepOn(int track) {
-  ++state[track].beat;
+  state[track].beat += state[track].rate;
   if (state[track].beat >= state[track].division) {
-    state[track].beat = 0;
+    state[track].beat -= state[track].division;
+    ++state[track].steps;
     stepPosition(track);
     state[track].stepped = true;
   } else {
@@ -214,65 +522,494 @@ void Tracks::stepOn(int track) {
 }
 
 void Tracks::stepPosition(int track) {
+  ++state[track].phase;
+  if (state[track].phase >= period(track)) state[track].phase = 0;
+  if (state[track].phase == 0) nextLoop(track);
+  locate(track);
+}
+
+void Tracks::seekTrack(int track) {
+  state[track].origin = 0;
+  unsigned long beats = ticks * state[track].rate + state[track].division - state[track].rate;
+  state[track].beat = beats % state[track].division;
+  state[track].steps = beats / state[track].division;
+  state[track].stepped = ticks > 0 && state[track].beat < state[track].rate;
+  state[track].loops = (state[track].steps + period(track) - 1) / period(track) - 1;
+  state[track].gate = gateMask(track, state[track].loops);
+  state[track].armed = false;
+  resetPhase(track);
+}
+
+void Tracks::locate(int track) {
+  int phase = state[track].phase;
+  int length = state[track].length;
+  state[track].forward = true;
   switch(tracks[track].play) {
     case Forward:
-      ++state[track].position;
-      Utilities::cycle(state[track].position, 0, state[track].length);
+      state[track].position = phase;
     break;
     case Backward:
-      --state[track].position;
-      Utilities::cycle(state[track].position, 0, state[track].length);
+      state[track].position = phase == 0 ? 0 : length + 1 - phase;
     break;
     case Random:
-      state[track].position = random(0, state[track].length + 1);
+      state[track].position = Utilities::scale(Utilities::hash(seed + track + (state[track].steps << 2)), length + 1);
     break;
     case Pendulum:
-      if (state[track].forward) ++state[track].position;
-      else --state[track].position;
-      if (Utilities::reverse(state[track].position, 0, state[track].length)) state[track].forward  = !state[track].forward ;
+      state[track].forward = phase <= length;
+      state[track].position = state[track].forward ? phase : 2 * length + 1 - phase;
     break;
   }
-  if(state[track].position == 0) mutate(track);
 }
 
-void Tracks::mutate(int track) {
-  int seed;
+int Tracks::period(int track) {
+  return tracks[track].play == PlayMode::Pendulum ? 2 * (state[track].length + 1) : state[track].length + 1;
+}
+
+void Tracks::nextLoop(int track) {
+  if (chains[track].count > 0) advanceChain(track);
+  if (!state[track].armed) arm(track);
+  state[track].gate = state[track].nextGate;
+  state[track].armed = false;
+  ++state[track].loops;
+  if (state[track].pending) {
+    state[track].length = state[track].nextLength;
+    state[track].origin = state[track].steps - 1;
+    state[track].phase = 0;
+    state[track].pending = false;
+  } else if (state[track].loops == 0) {
+    state[track].next = state[track].pattern;
+  } else if (!state[track].prepared) {
+    prepare(track);
+  }
+  state[track].pattern = state[track].next;
+  state[track].prepared = false;
+}
+
+void Tracks::commit(int track) {
+  if (state[track].pending) {
+    state[track].pattern = state[track].next;
+    state[track].length = state[track].nextLength;
+    state[track].pending = false;
+    state[track].prepared = false;
+    resetPhase(track);
+  }
+}
+
+void Tracks::restartChain(int track) {
+  Chain &chain = chains[track];
+  chain.index = 0;
+  chain.loop = 0;
+  chain.prefetched = false;
+  if (chain.count > 0) {
+    prefetch(track, 0);
+    loadLink(track);
+    commit(track);
+    chain.index = chain.count - 1;
+    chain.loop = getRepeats(track, chain.index) - 1;
+  }
+}
+
+void Tracks::seekChain(int track) {
+  Chain &chain = chains[track];
+  if (chain.count == 0) return;
+  if (state[track].loops == (unsigned int)-1) {
+    restartChain(track);
+    return;
+  }
+  unsigned int cycle = 0;
+  for (int link = 0; link < chain.count; ++link) cycle += getRepeats(track, link);
+  unsigned int loop = state[track].loops % cycle;
+  chain.index = 0;
+  while (loop >= (unsigned int)getRepeats(track, chain.index)) loop -= getRepeats(track, chain.index++);
+  chain.loop = loop;
+  prefetch(track, chain.index);
+  loadLink(track);
+  commit(track);
+}
+
+void Tracks::advanceChain(int track) {
+  Chain &chain = chains[track];
+  ++chain.loop;
+  if (chain.loop >= getRepeats(track, chain.index)) {
+    chain.loop = 0;
+    ++chain.index;
+    if (chain.index >= chain.count) chain.index = 0;
+    if (!chain.prefetched) prefetch(track, chain.index);
+    loadLink(track);
+  }
+}
+
+bool Tracks::isChainDue(int track) {
+  Chain &chain = chains[track];
+  return chain.count > 0 && !chain.prefetched && chain.loop + 1 >= getRepeats(track, chain.index);
+}
+
+void Tracks::prefetch(int track, int link) {
+  byte data[PRESET_DATA];
+  int slot = chains[track].links[link] & CHAIN_SLOT_MASK;
+  byte version = readRecord(PRESET_ADDRESS + slot * PRESET_SIZE, data, PRESET_DATA);
+  chained[track] = tracks[track];
+  if (version != 0) {
+    Packer packer(data);
+    Track stored;
+    for (int index = 0; index <= track; ++index) {
+      stored = tracks[track];
+      unpack(packer, stored, version);
+    }
+    copyPattern(chained[track], stored);
+  }
+  state[track].next = basePattern(chained[track]);
+  state[track].nextLength = baseLength(chained[track]);
+  state[track].pending = true;
+  state[track].prepared = true;
+  chains[track].prefetched = true;
+}
+
+void Tracks::loadLink(int track) {
+  copyPattern(tracks[track], chained[track]);
+  chains[track].prefetched = false;
+}
+
+int Tracks::getRepeats(int track, int link) {
+  return (chains[track].links[link] >> CHAIN_REPEAT_SHIFT) + 1;
+}
+
+void Tracks::copyPattern(Track &to, Track &from) {
+  to.pattern = from.pattern;
+  to.start = from.start;
+  to.end = from.end;
+  to.length = from.length;
+  to.density = from.density;
+  to.offset = from.offset;
+  to.patternType = from.patternType;
+}
+
+bool Tracks::isDeferred(int track) {
+  return tracks[track].quantise && ticks > 0;
+}
+
+void Tracks::prepare(int track) {
+  state[track].next = isGenerated(track) ? generate(track) : mutate(track);
+  state[track].prepared = true;
+}
+
+void Tracks::arm(int track) {
+  state[track].nextGate = gateMask(track, state[track].loops + 1);
+  state[track].armed = true;
+}
+
+unsigned int Tracks::gateMask(int track, unsigned int loop) {
+  unsigned long low = Utilities::hash(seed + track + ((unsigned long)loop << 2));
+  uint64_t threshold = ((uint64_t)Utilities::hash(low) << 32) | low;
+  unsigned int gate = 0;
+  for (int step = 0; step <= MAX_STEP_INDEX; ++step) {
+    bool chance = nibble(threshold, step) >= nibble(probabilities[track], step);
+    bitWrite(gate, step, chance && isMet(nibble(conditions[track], step), loop));
+  }
+  return gate;
+}
+
+bool Tracks::isMet(int condition, unsigned int loop) {
+  bool met = true;
+  if (condition == CONDITION_FIRST) met = loop == 0;
+  else if (condition == CONDITION_NOT_FIRST) met = loop != 0;
+  else if (condition > CONDITION_NOT_FIRST) met = loop % (condition - 1) == 0;
+  return met;
+}
+
+byte Tracks::nibble(uint64_t word, int step) {
+  return (byte)(word >> (step << 2)) & NIBBLE_MASK;
+}
+
+void Tracks::setNibble(uint64_t &word, int step, int value) {
+  word = (word & ~((uint64_t)NIBBLE_MASK << (step << 2))) | ((uint64_t)value << (step << 2));
+}
+
+int Tracks::mutate(int track) {
+  int base = state[track].pattern;
+  int pattern = state[track].pattern;
   switch(tracks[track].mutationSeed) {
     case MutationSeed::Original:
-      resetPattern(track);
-      seed = state[track].pattern;
+      base = basePattern(tracks[track]);
       break;
     case MutationSeed::Last:
-      seed = state[track].pattern;
+      base = state[track].pattern;
       break;
     case MutationSeed::LastInverted:
-      seed = state[track].pattern;
-      seed = ~seed;
+      base = ~state[track].pattern;
       break;
   }
 
   for (int index = 0; index <= state[track].length; ++index) {
-    bool step = bitRead(seed, index);
+    bool step = bitRead(base, index);
     if (random(1, MUTATION_FACTOR) <= pow(tracks[track].mutation,2)) step = !step;
-    bitWrite(state[track].pattern, index, step);
+    bitWrite(pattern, index, step);
   }
+  return pattern;
 }
 
 void Tracks::load() {
-  Settings settings;
-  EEPROM.get(CONFIG_ADDRESS, settings);
-  if(settings.version != CONFIG_VERSION) for(int track = 0; track < TRACKS; ++ track) initialiseTrack(track);
-  else for(int track = 0; track < TRACKS; ++ track) tracks[track] = settings.tracks[track];
+  byte grooves[USER_GROOVES * GROOVE_STEPS];
+  for(int track = 0; track < TRACKS; ++ track) initialiseTrack(track);
+  if (!loadSettings()) migrate();
+  userGrooves = readRecord(GROOVE_ADDRESS, grooves, USER_GROOVES * GROOVE_STEPS) >= GROOVE_VERSION;
+}
+
+bool Tracks::loadSettings() {
+  byte data[SETTINGS_SIZE];
+  byte version = readRecord(CONFIG_ADDRESS, data, SETTINGS_SIZE);
+  if (version != 0) {
+    Packer packer(data);
+    for(int track = 0; track < TRACKS; ++ track) unpack(packer, tracks[track], version);
+    if (version >= CHAIN_VERSION) for(int track = 0; track < TRACKS; ++ track) unpack(packer, chains[track]);
+    if (version >= STEP_VERSION) {
+      for(int track = 0; track < TRACKS; ++ track) probabilities[track] = unpack(packer);
+      for(int track = 0; track < TRACKS; ++ track) conditions[track] = unpack(packer);
+    }
+    if (version >= RATCHET_VERSION) {
+      for(int track = 0; track < TRACKS; ++ track) {
+        for (int step = 0; step <= MAX_STEP_INDEX; ++step) setNibble(ratchets[track], step, packer.read(RATCHET_BITS));
+      }
+    }
+  }
+  return version != 0;
+}
+
+byte Tracks::readRecord(int address, byte data[], int size) {
+  byte version = 0;
+  SettingsHeader header;
+  EEPROM.get(address, header);
+  if (header.magic == CONFIG_MAGIC && header.version >= PACKED_VERSION && header.version <= CONFIG_VERSION && header.size <= size) {
+    for (int index = 0; index < header.size; ++index) data[index] = EEPROM.read(address + sizeof(header) + index);
+    if (Utilities::crc16(data, header.size) == header.crc) version = header.version;
+  }
+  return version;
+}
+
+void Tracks::writeRecord(int address, byte data[], int size) {
+  SettingsHeader header = {CONFIG_MAGIC, CONFIG_VERSION, (byte)size, Utilities::crc16(data, size)};
+  EEPROM.put(address, header);
+  for (int index = 0; index < size; ++index) EEPROM.update(address + sizeof(header) + index, data[index]);
+}
+
+void Tracks::migrate() {
+  int stride = sizeof(LegacyTrack);
+  byte version = EEPROM.read(CONFIG_ADDRESS + TRACKS * stride);
+  if (version != LEGACY_VERSION) {
+    ++stride;
+    version = EEPROM.read(CONFIG_ADDRESS + TRACKS * stride);
+  }
+  if (version == LEGACY_VERSION || version == QUANTISE_VERSION) {
+    for(int track = 0; track < TRACKS; ++ track) {
+      int address = CONFIG_ADDRESS + track * stride;
+      LegacyTrack legacy;
+      EEPROM.get(address, legacy);
+      tracks[track].pattern = legacy.pattern;
+      tracks[track].start = legacy.start;
+      tracks[track].end = legacy.end;
+      tracks[track].length = legacy.length;
+      tracks[track].density = legacy.density;
+      tracks[track].offset = legacy.offset;
+      tracks[track].divider = legacy.divider;
+      tracks[track].shuffle = legacy.shuffle;
+      tracks[track].mutation = legacy.mutation;
+      tracks[track].play = legacy.play;
+      tracks[track].out = legacy.out;
+      tracks[track].patternType = legacy.patternType;
+      tracks[track].dividerType = legacy.dividerType;
+      tracks[track].mutationSeed = legacy.mutationSeed;
+      if (version >= QUANTISE_VERSION) tracks[track].quantise = EEPROM.read(address + sizeof(LegacyTrack));
+      bound(tracks[track]);
+    }
+    change = true;
+  }
+}
+
+void Tracks::store(int slot) {
+  byte data[PRESET_DATA] = {0};
+  Packer packer(data);
+  for(int track = 0; track < TRACKS; ++ track) pack(packer, tracks[track]);
+  writeRecord(PRESET_ADDRESS + slot * PRESET_SIZE, data, packer.size());
+}
+
+void Tracks::recall(int slot) {
+  byte data[PRESET_DATA] = {0};
+  byte version = readRecord(PRESET_ADDRESS + slot * PRESET_SIZE, data, PRESET_DATA);
+  if (version != 0) decodePreset(data, version);
+}
+
+int Tracks::getTracks(byte data[]) {
+  Packer packer(data);
+  for(int track = 0; track < TRACKS; ++ track) pack(packer, tracks[track]);
+  return packer.size();
+}
+
+bool Tracks::setTracks(byte data[], int size) {
+  bool valid = size == TRACKS_DATA;
+  if (valid) decodePreset(data, CONFIG_VERSION);
+  return valid;
+}
+
+int Tracks::getPatternWord(int track) {
+  return tracks[track].pattern;
+}
+
+void Tracks::setPatternWord(int track, int pattern) {
+  tracks[track].pattern = pattern;
+  resetPattern(track);
+  change = true;
+}
+
+void Tracks::decodePreset(byte data[], byte version) {
+  Packer packer(data);
+  for(int track = 0; track < TRACKS; ++ track) {
+    Track &current = tracks[track];
+    Track &recalled = chained[track];
+    recalled = current;
+    unpack(packer, recalled, version);
+    chains[track].prefetched = false;
+    if (current.pattern != recalled.pattern || current.start != recalled.start || current.end != recalled.end
+      || current.length != recalled.length || current.density != recalled.density || current.offset != recalled.offset
+      || current.patternType != recalled.patternType) {
+      state[track].next = basePattern(recalled);
+      state[track].nextLength = baseLength(recalled);
+      state[track].pending = true;
+      state[track].prepared = true;
+      bitSet(recalledPatterns, track);
+    } else if (bitRead(recalledPatterns, track)) {
+      state[track].pending = false;
+      state[track].prepared = false;
+      bitClear(recalledPatterns, track);
+    }
+  }
+  presetRecalled = true;
+}
+
+void Tracks::applyPreset() {
+  for(int track = 0; track < TRACKS; ++ track) applyPreset(track);
+  presetRecalled = false;
+  recalledPatterns = 0;
+  change = true;
+}
+
+void Tracks::applyPreset(int track) {
+  Track &current = tracks[track];
+  Track &recalled = chained[track];
+  bool division = current.divider != recalled.divider || current.dividerType != recalled.dividerType || current.ratioSteps != recalled.ratioSteps || current.ratioClocks != recalled.ratioClocks;
+  bool play = current.play != recalled.play;
+  current = recalled;
+  if (division) resetDivision(track);
+  if (bitRead(recalledPatterns, track) && !isDeferred(track)) commit(track);
+  else if (play) resetPhase(track);
 }
 
 void Tracks::save() {
   if (change) {
-    Settings settings = {{tracks[0], tracks[1], tracks[2]}, CONFIG_VERSION};
-    EEPROM.put(CONFIG_ADDRESS, settings);
+    byte data[SETTINGS_SIZE] = {0};
+    Packer packer(data);
+    for(int track = 0; track < TRACKS; ++ track) pack(packer, tracks[track]);
+    for(int track = 0; track < TRACKS; ++ track) pack(packer, chains[track]);
+    for(int track = 0; track < TRACKS; ++ track) pack(packer, probabilities[track]);
+    for(int track = 0; track < TRACKS; ++ track) pack(packer, conditions[track]);
+    for(int track = 0; track < TRACKS; ++ track) {
+      for (int step = 0; step <= MAX_STEP_INDEX; ++step) packer.write(nibble(ratchets[track], step), RATCHET_BITS);
+    }
+    writeRecord(CONFIG_ADDRESS, data, packer.size());
     change = false;
   }
 }
 
+void Tracks::pack(Packer &packer, Track &track) {
+  packer.write(track.pattern, 16);
+  packer.write(track.start, 4);
+  packer.write(track.end, 4);
+  packer.write(track.length, 4);
+  packer.write(track.density, 4);
+  packer.write(track.offset, 4);
+  packer.write(track.divider, 3);
+  packer.write(track.shuffle, 4);
+  packer.write(track.mutation, 6);
+  packer.write(track.play, 2);
+  packer.write(track.out, 2);
+  packer.write(track.patternType, 2);
+  packer.write(track.dividerType, 2);
+  packer.write(track.mutationSeed, 2);
+  packer.write(track.quantise, 1);
+  packer.write(track.gateLength, 4);
+  packer.write(track.groove, GROOVE_BITS);
+  packer.write(track.ratioSteps - 1, RATIO_BITS);
+  packer.write(track.ratioClocks - 1, RATIO_BITS);
+}
+
+void Tracks::unpack(Packer &packer, Track &track, byte version) {
+  track.pattern = packer.read(16);
+  track.start = packer.read(4);
+  track.end = packer.read(4);
+  track.length = packer.read(4);
+  track.density = packer.read(4);
+  track.offset = packer.read(4);
+  track.divider = packer.read(3);
+  track.shuffle = packer.read(4);
+  track.mutation = packer.read(6);
+  track.play = (PlayMode) packer.read(2);
+  track.out = (OutMode) packer.read(2);
+  track.patternType = (PatternType) packer.read(2);
+  track.dividerType = (DividerType) packer.read(2);
+  track.mutationSeed = (MutationSeed) packer.read(2);
+  track.quantise = packer.read(1);
+  if (version >= GATE_VERSION) track.gateLength = packer.read(4);
+  if (version >= GROOVE_VERSION) track.groove = packer.read(GROOVE_BITS);
+  if (version >= RATIO_VERSION) {
+    track.ratioSteps = packer.read(RATIO_BITS) + 1;
+    track.ratioClocks = packer.read(RATIO_BITS) + 1;
+  } else if (track.dividerType == DividerType::Ratio) {
+    track.ratioSteps = pgm_read_byte(&LEGACY_RATIOS[track.divider][LEGACY_RATIO_STEPS]);
+    track.ratioClocks = pgm_read_byte(&LEGACY_RATIOS[track.divider][LEGACY_RATIO_CLOCKS]);
+  }
+  bound(track);
+}
+
+void Tracks::bound(Track &track) {
+  int dividerType = track.dividerType;
+  int mutationSeed = track.mutationSeed;
+  Utilities::bound(track.end, 0, MAX_STEP_INDEX);
+  Utilities::bound(track.start, 0, track.end);
+  Utilities::bound(track.length, 0, MAX_STEP_INDEX);
+  Utilities::bound(track.density, 0, maxDensity(track));
+  Utilities::bound(track.offset, 0, track.length);
+  Utilities::bound(dividerType, DividerType::Beat, DividerType::Ratio);
+  track.dividerType = (DividerType) dividerType;
+  Utilities::bound(track.divider, 0, maxDivider(track.dividerType));
+  Utilities::bound(track.mutation, 0, MAX_MUTATION);
+  Utilities::bound(mutationSeed, MutationSeed::Original, MutationSeed::LastInverted);
+  track.mutationSeed = (MutationSeed) mutationSeed;
+  Utilities::bound(track.gateLength, 0, MAX_GATE_LENGTH);
+  Utilities::bound(track.groove, 0, MAX_GROOVE);
+  Utilities::bound(track.ratioClocks, 1, MAX_RATIO);
+  Utilities::bound(track.ratioSteps, 1, track.ratioClocks);
+}
+
+void Tracks::pack(Packer &packer, Chain &chain) {
+  packer.write(chain.count, 4);
+  for (int link = 0; link < chain.count; ++link) packer.write(chain.links[link], 8);
+}
+
+void Tracks::unpack(Packer &packer, Chain &chain) {
+  chain.count = packer.read(4);
+  if (chain.count > CHAIN_LENGTH) chain.count = 0;
+  for (int link = 0; link < chain.count; ++link) chain.links[link] = packer.read(8);
+}
+
+void Tracks::pack(Packer &packer, uint64_t word) {
+  packer.write(word, 32);
+  packer.write(word >> 32, 32);
+}
+
+uint64_t Tracks::unpack(Packer &packer) {
+  uint64_t word = packer.read(32);
+  return word | ((uint64_t)packer.read(32) << 32);
+}
+
 void Tracks::initialiseTrack(int track) {
   tracks[track].pattern = 0;
   tracks[track].start = 0;
@@ -282,72 +1019,180 @@ void Tracks::initialiseTrack(int track) {
   tracks[track].offset = 0;
   tracks[track].divider = 0;
   tracks[track].shuffle = 0;
+  tracks[track].mutation = 0;
   tracks[track].play = PlayMode::Forward;
   tracks[track].out = OutMode::Trigger;
   tracks[track].patternType = PatternType::Programmed;
   tracks[track].dividerType = DividerType::Beat;
+  tracks[track].mutationSeed = MutationSeed::Original;
+  tracks[track].quantise = false;
+  tracks[track].gateLength = MAX_GATE_LENGTH / 2;
+  tracks[track].groove = 0;
+  tracks[track].ratioSteps = 2;
+  tracks[track].ratioClocks = 3;
+  probabilities[track] = 0;
+  conditions[track] = 0;
+  ratchets[track] = 0;
 }
 
 void Tracks::initialiseState(int track) {
-  state[track].position = 0;
-  state[track].beat = 0;
-  state[track].forward = true;
-  state[track].stepped = false;
+  state[track].steps = 0;
+  state[track].origin = 0;
+  state[track].pending = false;
   resetLength(track);
   resetDivision(track);
   resetPattern(track);
 }
 
 void Tracks::resetLength(int track) {
-  switch(tracks[track].patternType) {
+  if (!isDeferred(track)) {
+    state[track].length = baseLength(tracks[track]);
+    resetPhase(track);
+  }
+}
+
+void Tracks::resetPattern(int track) {
+  if (isDeferred(track)) {
+    state[track].next = basePattern(tracks[track]);
+    state[track].nextLength = baseLength(tracks[track]);
+    state[track].pending = true;
+    state[track].prepared = true;
+  } else {
+    state[track].pattern = basePattern(tracks[track]);
+    state[track].prepared = false;
+  }
+}
+
+int Tracks::baseLength(Track &track) {
+  int length = 0;
+  switch(track.patternType) {
     case Programmed:
-      state[track].length = tracks[track].end - tracks[track].start;
+      length = track.end - track.start;
       break;
     case Euclidean:
-      state[track].length = tracks[track].length;
+    case Turing:
+    case Automaton:
+      length = track.length;
       break;
   }
+  return length;
 }
 
-void Tracks::resetPattern(int track) {
-  switch(tracks[track].patternType) {
+int Tracks::basePattern(Track &track) {
+  int pattern = 0;
+  switch(track.patternType) {
     case Programmed:
-      resetProgrammed(track);
+      pattern = programmedPattern(track);
       break;
     case Euclidean:
-      resetEuclidean(track);
+      pattern = euclideanPattern(track);
+      break;
+    case Turing:
+      pattern = turingPattern(track);
+      break;
+    case Automaton:
+      pattern = automatonPattern(track);
       break;
   }
+  return pattern;
 }
 
-void Tracks::resetProgrammed(int track) {
-  state[track].pattern = 0;
+int Tracks::programmedPattern(Track &track) {
+  int pattern = 0;
   int index = 0;
-  for (int step = tracks[track].start; step <= tracks[track].end; ++step) {
-    bitWrite(state[track].pattern, index, bitRead(tracks[track].pattern, step));
+  for (int step = track.start; step <= track.end; ++step) {
+    bitWrite(pattern, index, bitRead(track.pattern, step));
     ++index;
   }
+  return pattern;
+}
+
+int Tracks::euclideanPattern(Track &track) {
+  int pattern = euclidean(track.length + 1, track.density + 1);
+  if (track.offset > 0) rotate(pattern, 0, track.length, track.offset);
+  return pattern;
+}
+
+int Tracks::turingPattern(Track &track) {
+  return Utilities::hash(seed + (track.length << 4)) & loopMask(track.length);
+}
+
+int Tracks::automatonPattern(Track &track) {
+  return 1 << track.offset;
+}
+
+bool Tracks::isGenerated(int track) {
+  return tracks[track].patternType == PatternType::Turing || tracks[track].patternType == PatternType::Automaton;
+}
+
+int Tracks::generate(int track) {
+  return tracks[track].patternType == PatternType::Turing ? turing(track) : automaton(track);
+}
+
+int Tracks::turing(int track) {
+  int length = state[track].length;
+  unsigned int shift = state[track].pattern;
+  unsigned long noise = Utilities::hash(seed + track + (state[track].steps << 2));
+  int chance = ((length - tracks[track].density) * TURING_CHANCE) / (length + 1);
+  unsigned int flips = Utilities::chance(noise, Utilities::hash(noise), chance);
+  for (int step = 0; step <= length; ++step) shift = (shift << 1) | (bitRead(shift, length) ^ bitRead(flips, step));
+  return shift & loopMask(length);
+}
+
+int Tracks::automaton(int track) {
+  int length = state[track].length;
+  unsigned int mask = loopMask(length);
+  unsigned int cells = state[track].pattern & mask;
+  if (cells == 0) cells = automatonPattern(tracks[track]) & mask;
+  unsigned int left = (cells << 1) | (cells >> length);
+  unsigned int right = (cells >> 1) | (cells << length);
+  byte rule = pgm_read_byte(&RULES[tracks[track].density]);
+  unsigned int next = 0;
+  for (int neighbours = 0; neighbours < 8; ++neighbours) {
+    if (bitRead(rule, neighbours)) next |= (bitRead(neighbours, 2) ? left : ~left) & (bitRead(neighbours, 1) ? cells : ~cells) & (bitRead(neighbours, 0) ? right : ~right);
+  }
+  return next & mask;
+}
+
+int Tracks::maxDensity(Track &track) {
+  return track.patternType == PatternType::Automaton ? MAX_STEP_INDEX : track.length;
 }
 
-void Tracks::resetEuclidean(int track) {
-  state[track].pattern = 0;
-  state[track].pattern = euclidean(tracks[track].length + 1, tracks[track].density + 1);
-  if (tracks[track].offset > 0) rotate(state[track].pattern, 0, tracks[track].length, tracks[track].offset);
+unsigned int Tracks::loopMask(int length) {
+  return (1UL << (length + 1)) - 1;
 }
 
 void Tracks::resetDivision(int track) {
-  Utilities::bound(tracks[track].divider, 0, tracks[track].dividerType == DividerType::Beat ? MAX_BEAT_DIVIDER : MAX_TRIPLET_DIVIDER);
-  state[track].division = calculateDivision(tracks[track].divider, tracks[track].dividerType);
-  state[track].beat = 0;
+  Utilities::bound(tracks[track].divider, 0, maxDivider(tracks[track].dividerType));
+  state[track].division = calculateDivision(tracks[track]);
+  state[track].rate = calculateRate(tracks[track]);
+  seekTrack(track);
+}
+
+void Tracks::resetPhase(int track) {
+  state[track].phase = (state[track].steps - state[track].origin + period(track) - 1) % period(track);
+  locate(track);
 }
 
-int Tracks::calculateDivision(int divider, DividerType type) {
+int Tracks::maxDivider(DividerType type) {
+  int max = MAX_BEAT_DIVIDER;
+  if (type == DividerType::Triplet) max = MAX_TRIPLET_DIVIDER;
+  else if (type == DividerType::Ratio) max = MAX_RATIO_DIVIDER;
+  return max;
+}
+
+int Tracks::calculateDivision(Track &track) {
   int division = 1;
-  if (type == DividerType::Beat) division = 1 << divider;
-  else if (type == DividerType::Triplet) division = (divider + 1) * 3;
+  if (track.dividerType == DividerType::Beat) division = 1 << track.divider;
+  else if (track.dividerType == DividerType::Triplet) division = (track.divider + 1) * 3;
+  else if (track.dividerType == DividerType::Ratio) division = track.ratioClocks;
   return division;
 }
 
+int Tracks::calculateRate(Track &track) {
+  return track.dividerType == DividerType::Ratio ? track.ratioSteps : 1;
+}
+
 int Tracks::euclidean(int length, int density) {
   int euclidean = 0;
   if(density >= length) density = length;
@@ -1,8 +1,7 @@
 #ifndef Tracks_h_
 #define Tracks_h_
 
-#include "HardwareInterface.h"
-#include <LedControl.h>
+#include "Packer.h"
 
 enum PlayMode {
   Forward = 0,
@@ -14,17 +13,30 @@ enum PlayMode {
 enum OutMode {
   Trigger = 0,
   Clock = 1,
-  Gate = 2
+  Gate = 2,
+  Length = 3
 };
 
 enum PatternType {
   Programmed,
-  Euclidean
+  Euclidean,
+  Turing,
+  Automaton
 };
 
 enum DividerType {
   Beat,
-  Triplet
+  Triplet,
+  Ratio
+};
+
+enum Logic {
+  Inverse,
+  And,
+  Or,
+  Xor,
+  Nand,
+  AndNot
 };
 
 enum MutationSeed {
@@ -48,6 +60,11 @@ struct Track {
   PatternType patternType;
   DividerType dividerType;
   MutationSeed mutationSeed;
+  bool quantise;
+  int gateLength;
+  int groove;
+  int ratioSteps;
+  int ratioClocks;
 };
 
 struct TrackState {
@@ -58,13 +75,64 @@ struct TrackState {
   bool stepped;
   int beat;
   int division;
+  int rate;
+  unsigned long steps;
+  unsigned long origin;
+  int phase;
+  unsigned int loops;
+  unsigned int gate;
+  unsigned int nextGate;
+  bool armed;
+  int next;
+  int nextLength;
+  bool prepared;
+  bool pending;
 };
 
-struct Settings {
-  Track tracks[3];
+#define CHAIN_LENGTH 8
+
+struct Chain {
+  byte links[CHAIN_LENGTH];
+  byte count;
+  byte index;
+  byte loop;
+  bool prefetched;
+};
+
+struct LegacyTrack {
+  int pattern;
+  int start;
+  int end;
+  int length;
+  int density;
+  int offset;
+  int divider;
+  int shuffle;
+  int mutation;
+  PlayMode play;
+  OutMode out;
+  PatternType patternType;
+  DividerType dividerType;
+  MutationSeed mutationSeed;
+};
+
+struct SettingsHeader {
+  byte magic;
   byte version;
+  byte size;
+  uint16_t crc;
 };
 
+#define GROOVE_STEPS 16
+#define BUILT_IN_GROOVES 8
+#define USER_GROOVES 4
+#define GROOVES (BUILT_IN_GROOVES + USER_GROOVES)
+#define PRESET_SLOTS 16
+#define PRESET_SIZE 48
+#define PRESET_DATA (PRESET_SIZE - sizeof(SettingsHeader))
+#define TRACK_BITS 76
+#define TRACKS_DATA ((3 * TRACK_BITS + 7) / 8)
+
 class Tracks {
 public:
   Tracks();
@@ -80,43 +148,141 @@ public:
   void setDivider(int track, int offset);
   void nextPatternType(int track);
   void nextDividerType(int track);
+  void setRatioSteps(int track, int offset);
+  void setRatioClocks(int track, int offset);
   void setShuffle(int track, int offset);
+  void setGroove(int track, int offset);
   void setMutation(int track, int offset);
   void nextMutationSeed(int track);
+  void setQuantise(int track, int offset);
+  void setLogic(Logic logic, int a, int b);
+  void setProbability(int track, int step, int offset);
+  void setCondition(int track, int step, int offset);
+  void setRatchet(int track, int step, int offset);
+  void clearStep(int track, int step);
+  void appendChain(int track, int slot, int repeats);
+  void removeChain(int track);
   int getStart(int track);
   int getEnd(int track);
   int getLength(int track);
   int getPattern(int track);
+  int getEditPattern(int track);
   int getPosition(int position);
   int getDivider(int track);
   int getStep(int track);
+  int getSteps();
   int getStepped(int track);
   int getMutation(int track);
+  unsigned long getTicks();
   PatternType getPatternType(int track);
   DividerType getDividerType(int track);
+  int getRatioSteps(int track);
+  int getRatioClocks(int track);
   PlayMode getPlayMode(int track);
   OutMode getOutMode(int track);
+  int getGateLength(int track);
+  unsigned long getStepPeriod(int track, unsigned long clockPeriod);
   MutationSeed getMutationSeed(int track);
   int getShuffle(int track);
+  int getGroove(int track);
+  int getGrooveOffset(int groove, int step);
+  unsigned long getGrooveDelay(int track, unsigned long clockPeriod);
+  bool storeGroove(int groove, byte offsets[], int size);
+  bool getQuantise(int track);
+  Logic getLogic();
+  int getProbability(int track, int step);
+  int getCondition(int track, int step);
+  int getRatchet(int track);
+  int getRatchet(int track, int step);
+  static bool combine(Logic logic, bool a, bool b);
+  uint64_t getChain(int track);
   void stepOn();
+  void seek(unsigned long tick);
+  void prepare();
+  void commit();
+  void store(int slot);
+  void recall(int slot);
+  int getTracks(byte data[]);
+  bool setTracks(byte data[], int size);
+  int getPatternWord(int track);
+  void setPatternWord(int track, int pattern);
   void save();
   void reset();
 private:
   bool change = false;
+  unsigned long ticks = 0;
+  unsigned long seed = 0;
+  bool presetRecalled = false;
+  byte recalledPatterns = 0;
+  Logic logic = Logic::Inverse;
+  bool userGrooves = false;
+  byte outputs[1 << 3];
   Track tracks[3];
   TrackState state[3];
+  Chain chains[3];
+  uint64_t probabilities[3];
+  uint64_t conditions[3];
+  uint64_t ratchets[3];
+  Track chained[3];
   void stepOn(int track);
   void stepPosition(int track);
-  void mutate(int track);
+  void seekTrack(int track);
+  void locate(int track);
+  int period(int track);
+  void nextLoop(int track);
+  void prepare(int track);
+  void arm(int track);
+  unsigned int gateMask(int track, unsigned int loop);
+  bool isMet(int condition, unsigned int loop);
+  byte nibble(uint64_t word, int step);
+  void setNibble(uint64_t &word, int step, int value);
+  void commit(int track);
+  void restartChain(int track);
+  void seekChain(int track);
+  void advanceChain(int track);
+  bool isChainDue(int track);
+  void prefetch(int track, int link);
+  void loadLink(int track);
+  int getRepeats(int track, int link);
+  void copyPattern(Track &to, Track &from);
+  bool isDeferred(int track);
+  int mutate(int track);
   void load();
+  bool loadSettings();
+  void migrate();
+  byte readRecord(int address, byte data[], int size);
+  void writeRecord(int address, byte data[], int size);
+  void decodePreset(byte data[], byte version);
+  void applyPreset();
+  void applyPreset(int track);
+  void pack(Packer &packer, Track &track);
+  void unpack(Packer &packer, Track &track, byte version);
+  void bound(Track &track);
+  void pack(Packer &packer, Chain &chain);
+  void unpack(Packer &packer, Chain &chain);
+  void pack(Packer &packer, uint64_t word);
+  uint64_t unpack(Packer &packer);
   void initialiseTrack(int track);
   void initialiseState(int track);
   void resetLength(int track);
   void resetDivision(int track);
+  void resetPhase(int track);
   void resetPattern(int track);
-  void resetProgrammed(int track);
-  void resetEuclidean(int track);
-  int calculateDivision(int divider, DividerType type);
+  int baseLength(Track &track);
+  int basePattern(Track &track);
+  int programmedPattern(Track &track);
+  int euclideanPattern(Track &track);
+  int turingPattern(Track &track);
+  int automatonPattern(Track &track);
+  bool isGenerated(int track);
+  int generate(int track);
+  int turing(int track);
+  int automaton(int track);
+  int maxDensity(Track &track);
+  unsigned int loopMask(int length);
+  int maxDivider(DividerType type);
+  int calculateDivision(Track &track);
+  int calculateRate(Track &track);
   int euclidean(int length, int density);
   void build(int pattern[], int level, int counts[], int remainders[]);
   void build(int pattern[], int &step, int level, int counts[], int remainders[]);
@@ -1,3 +1,4 @@
+#include <stdint.h>
 
 class Utilities {
 public:
@@ -13,6 +14,39 @@ public:
     if (value < min ) value = max;
     else if (value > max) value = min;
   }
+  static unsigned long hash(unsigned long value) {
+    value ^= value >> 16;
+    value *= 0x45d9f3bUL;
+    value ^= value >> 16;
+    value *= 0x45d9f3bUL;
+    value ^= value >> 16;
+    return value;
+  }
+  static int scale(unsigned long value, int range) {
+    return ((value & 0xFFFF) * range) >> 16;
+  }
+  static uint16_t chance(unsigned long noise, unsigned long more, int sixteenths) {
+    uint16_t words[4] = {(uint16_t)(noise >> 16), (uint16_t)noise, (uint16_t)(more >> 16), (uint16_t)more};
+    uint16_t below = 0;
+    uint16_t equal = 0xFFFF;
+    for (int bit = 3; bit >= 0; --bit) {
+      if (sixteenths & (1 << bit)) {
+        below |= equal & ~words[3 - bit];
+        equal &= words[3 - bit];
+      } else {
+        equal &= ~words[3 - bit];
+      }
+    }
+    return below;
+  }
+  static uint16_t crc16(const uint8_t *data, int length) {
+    uint16_t crc = 0xFFFF;
+    for (int index = 0; index < length; ++index) {
+      crc ^= (uint16_t)data[index] << 8;
+      for (int bit = 0; bit < 8; ++bit) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+  }
   static bool reverse(int &value, int min, int max) {
     bool reversed = false;
     if (value > max) {
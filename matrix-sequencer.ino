@@ -8,12 +8,20 @@
 #include "Utilities.h"
 #include "ClockGenerator.h"
 #include "Shuffle.h"
+#include "Protocol.h"
+#include "Monitor.h"
+#include "Benchmark.h"
+#include "Sync.h"
 
 #define EDIT_WAIT 5000
 #define CLOCK_WAIT 5000
-#define EDIT_MODES 4
+#define EDIT_MODES 6
 #define EDIT_TRACKS 3
 #define OFF_BEAT 3
+#define ENCODER_BATCH 8
+#define MAX_REPEATS 16
+#define RATCHET_WIDTH 8
+#define BAR_CLOCKS 16
 
 // hardware config
 #define ENCODERS_REVERSED 1
@@ -31,10 +39,31 @@ enum EditAction {
   EditShuffle,
   EditMutation,
   EditMutationSeed,
+  EditQuantise,
+  EditGroove,
+  EditResetMode,
+  EditSyncRole,
   EditClockSpeed,
+  EditClockMultiplier,
   EditClockWidth,
   EditClockState,
-  EditOffBeatOutput
+  EditOffBeatOutput,
+  EditPreset,
+  EditRepeats,
+  EditChain,
+  EditStep
+};
+
+enum ShuffleControl {
+  ShuffleAmount,
+  ShuffleGroove,
+  ShuffleReset,
+  ShuffleSync
+};
+
+enum RatioControl {
+  RatioClocks,
+  RatioSteps
 };
 
 struct EditMode {
@@ -48,16 +77,22 @@ struct EditMode {
 Display display = Display();
 Encoders encoders = Encoders(ENCODERS_REVERSED);
 Buttons buttons = Buttons();
-Input clock = Input(0);
-Input reset = Input(1);
-Output outs[4] = {Output(11), Output(12), Output(13), Output(17)};
+Input<0> clock;
+Input<1> reset;
+Outputs<11, 12, 13, 17> outs;
 Tracks tracks = Tracks();
 EditMode editModes[EDIT_MODES];
 ClockGenerator clockGenerator = ClockGenerator();
 Shuffle shuffle = Shuffle();
+Monitor monitor = Monitor();
+Benchmark benchmark = Benchmark();
+Sync sync = Sync();
+Protocol protocol = Protocol(tracks, clockGenerator, monitor, benchmark, sync);
 int edit = -1;
 int cursor = 0;
 int active = 0;
+int preset = 0;
+int repeats = 1;
 EditAction action = EditAction::NoAction;
 unsigned long now =  0;
 unsigned long lastEdit = 0;
@@ -65,6 +100,25 @@ unsigned long lastClock = 0;
 bool lengthMarker = true;
 bool offBeatOut = true;
 bool clocked = false;
+bool resetPending = false;
+ResetMode resetMode = ResetMode::Immediate;
+ShuffleControl shuffleControl = ShuffleControl::ShuffleAmount;
+RatioControl ratioControl = RatioControl::RatioClocks;
+
+#if defined(__AVR__)
+ISR(TIMER1_COMPA_vect) {
+  outs.fire();
+}
+
+ISR(TIMER1_COMPB_vect) {
+  benchmark.tick();
+}
+
+ISR(PCINT1_vect) {
+  Monitor::count();
+  reset.latch();
+}
+#endif
 
 void setup() {
   initialiseEditModes();
@@ -73,27 +127,42 @@ void setup() {
   buttons.initialise();
   clock.initialise();
   reset.initialise();
-  for(int track = 0; track < EDIT_TRACKS; ++track) outs[track].initialise();
+  reset.initialiseLatch();
+  outs.initialise();
+  monitor.initialise();
+  protocol.initialise();
   clearEditAction();
   display.indicateMode(edit);
   handleButtonHeld(Control::One);
 }
 
 void loop() {
+  now = millis();
+  if (monitor.pass(shuffle.getPeriod())) display.indicateOverrun();
   handleReset(reset.signal());
 
-  if (!clockGenerator.isRunning()) handleClock(clock.signal());
-  else handleClock(clockGenerator.tick());
+  bool internal = benchmark.isRunning() || sync.getRole() == SyncRole::Follower || clockGenerator.isRunning();
+  Signal signal = clockSignal();
+  if (internal) monitor.sync();
+  else if (signal == Signal::Rising) monitor.process();
+  handleClock(signal);
+  if (signal == Signal::Rising) benchmark.measure();
 
-  handleEncoderEvent(encoders.event());
+  handleEncoderEvents();
   handleButtonEvent(buttons.event());
+  protocol.poll();
+
+  if (!clocked) tracks.commit();
+  tracks.prepare();
 
   if (lastEdit != 0 && (millis() - lastEdit) > EDIT_WAIT) {
       clearEditAction();
   }
 
-  drawTracks();
-  display.render();
+  if (signal != Signal::Rising) {
+    if (display.isDue()) drawTracks();
+    display.render();
+  }
 }
 
 void drawTracks() {
@@ -102,18 +171,45 @@ void drawTracks() {
   }
 }
 
+Signal clockSignal() {
+  if (benchmark.isRunning()) return benchmark.signal();
+  if (sync.getRole() == SyncRole::Follower) return sync.follow(tracks);
+  if (clockGenerator.isRunning()) return clockGenerator.tick();
+  return clock.signal();
+}
+
 void handleReset(Signal signal) {
-  if (signal == Signal::Rising) {
-    shuffle.reset();
-    tracks.reset();
+  if (reset.isLatched()) {
+    resetPending = true;
+    if (sync.getRole() == SyncRole::Leader) protocol.sendReset(resetMode);
   }
+  if (sync.isResetLatched()) {
+    resetMode = sync.getResetMode();
+    resetPending = true;
+  }
+  if (resetPending && resetMode == ResetMode::Immediate) applyReset();
   if (signal == Signal::Rising || signal == Signal::High) display.indicateReset();
 }
 
+void applyReset() {
+  tracks.reset();
+  resetPending = false;
+}
+
+bool isResetDue() {
+  return resetPending && (resetMode == ResetMode::NextClock || (resetMode == ResetMode::NextBar && tracks.getTicks() % BAR_CLOCKS == 0));
+}
+
 void handleClock(Signal signal) {
+  if (signal == Signal::Rising && isResetDue()) applyReset();
   shuffle.clock(signal);
-  if (signal == Signal::Rising) tracks.stepOn();
+  if (signal == Signal::Rising) {
+    tracks.stepOn();
+    if (sync.getRole() == SyncRole::Leader) protocol.sendClock(tracks.getTicks());
+    for (int track = 0; track <= OFF_BEAT; ++track) if (tracks.getStepped(track)) shuffle.delay(track, tracks.getGrooveDelay(track, shuffle.getPeriod()));
+  }
   if (signal == Signal::Low && (now - lastClock) > CLOCK_WAIT) {
+    if (clocked && sync.getRole() == SyncRole::Leader) protocol.sendStop();
     clocked = false;
     lastClock = 0;
   } else if (signal == Signal::Rising || signal == Signal::High) {
@@ -121,36 +217,58 @@ void handleClock(Signal signal) {
     lastClock = now;
     display.indicateClock();
   }
-  for (int track = 0; track < EDIT_TRACKS; ++track) handleStep(track);
-  if (offBeatOut) handleStep(OFF_BEAT);
-  else outs[OFF_BEAT].signal(signal, OutMode::Clock, 1);
+  int steps = tracks.getSteps();
+  for (int track = 0; track < EDIT_TRACKS; ++track) handleStep(track, steps);
+  if (offBeatOut) handleStep(OFF_BEAT, steps);
+  else outs.signal(OFF_BEAT, signal, OutMode::Clock, 1);
+}
+
+void handleStep(int track, int steps) {
+  int step = bitRead(steps, track);
+  Signal signal = shuffle.tick(track);
+  if (!tracks.getStepped(track) && !shuffle.isDelayed(track)) signal = Signal::Low;
+  int output = outs.signal(track, signal, tracks.getOutMode(track), step);
+  if (output && signal == Signal::Rising && track < EDIT_TRACKS) pulse(track);
+  if (output) display.indicateTrack(track);
 }
 
-void handleStep(int track) {
-  int step = tracks.getStep(track);
-  Signal signal = shuffle.tick(track, tracks.getShuffle(track));
-  if (!tracks.getStepped(track) && Signal::Rising) signal = Signal::Low;
-  int output = outs[track].signal(signal, tracks.getOutMode(track), step);
-  if (output) display.indicateTrack(track);
+void pulse(int track) {
+  unsigned long period = shuffle.getPeriod();
+  int ratchet = tracks.getRatchet(track);
+  if (period > 0 && tracks.getOutMode(track) == OutMode::Length) outs.pulse(track, ratchet, tracks.getStepPeriod(track, period), tracks.getGateLength(track));
+  else if (period > 0 && ratchet > 1) outs.pulse(track, ratchet, period, RATCHET_WIDTH);
+}
+
+void handleEncoderEvents() {
+  for (int event = 0; event < ENCODER_BATCH; ++event) {
+    EncoderEvent encoderEvent = encoders.event();
+    if (encoderEvent.control == Control::NoControl) break;
+    handleEncoderEvent(encoderEvent);
+  }
 }
 
 void handleEncoderEvent(EncoderEvent event) {
   if (event.control != Control::NoControl) lastEdit = millis();
+  int change = isAccelerated(action) ? event.state * event.speed : event.state;
   switch(event.control) {
     case Control::One:
-      editModes[edit].oneRotate(event.state);
+      editModes[edit].oneRotate(change);
       break;
     case Control::Two:
-      editModes[edit].twoRotate(event.state);
+      editModes[edit].twoRotate(change);
       break;
     case Control::Three:
-      editModes[edit].threeRotate(event.state);
+      editModes[edit].threeRotate(change);
       break;
     case Control::NoControl:
       break;
   }
 }
 
+bool isAccelerated(EditAction current) {
+  return current == EditAction::EditClockSpeed || current == EditAction::EditClockWidth || current == EditAction::EditMutation;
+}
+
 void handleButtonEvent(ButtonEvent event) {
   if (event.state == ButtonState::Clicked) handleButtonClick(event.control);
   else if (event.state == ButtonState::Held) handleButtonHeld(event.control);
@@ -213,7 +331,7 @@ void lengthEdit(int change) {
     if (tracks.getPatternType(active) == PatternType::Programmed) {
       if (lengthMarker) tracks.setEnd(active, change);
       else tracks.setStart(active, change);
-    } else if (tracks.getPatternType(active) == PatternType::Euclidean) {
+    } else {
       tracks.setLength(active, change);
     }
   }
@@ -233,7 +351,7 @@ void initialiseLengthEdit() {
 
 void lengthView() {
   if (tracks.getPatternType(active) == PatternType::Programmed) display.drawLengthView(active, tracks.getStart(active), tracks.getEnd(active), lengthMarker);
-  else if (tracks.getPatternType(active) == PatternType::Euclidean) display.drawLengthView(active, tracks.getLength(active));
+  else display.drawLengthView(active, tracks.getLength(active));
 }
 
 void movePatternCursor(int change) {
@@ -241,7 +359,7 @@ void movePatternCursor(int change) {
     initialisePatternEdit();
   } else {
     if (tracks.getPatternType(active) == PatternType::Programmed) moveCursor(change, tracks.getLength(active));
-    else if (tracks.getPatternType(active) == PatternType::Euclidean) tracks.setDensity(active, change);
+    else tracks.setDensity(active, change);
   }
   patternView();
 }
@@ -258,8 +376,8 @@ void initialisePatternEdit() {
 }
 
 void patternView() {
-  if (tracks.getPatternType(active) == PatternType::Programmed) display.drawProgrammedView(active, tracks.getPattern(active));
-  else if (tracks.getPatternType(active) == PatternType::Euclidean) display.drawEuclideanView(active, tracks.getPattern(active));
+  if (tracks.getPatternType(active) == PatternType::Programmed) display.drawProgrammedView(active, tracks.getEditPattern(active));
+  else display.drawEuclideanView(active, tracks.getEditPattern(active));
 }
 
 void offsetEdit(int change) {
@@ -267,9 +385,9 @@ void offsetEdit(int change) {
     setEditAction(EditAction::EditOffset);
   } else {
     if (tracks.getPatternType(active) == PatternType::Programmed) tracks.rotatePattern(active, change);
-    else if (tracks.getPatternType(active) == PatternType::Euclidean) tracks.setOffset(active, change);
+    else tracks.setOffset(active, change);
   }
-  display.drawOffsetView(active, tracks.getPattern(active));
+  display.drawOffsetView(active, tracks.getEditPattern(active));
 }
 
 void playModeEdit(int change) {
@@ -281,13 +399,23 @@ void playModeEdit(int change) {
 void outModeEdit(int change) {
   if (action != EditAction::EditOutMode) setEditAction(EditAction::EditOutMode);
   else tracks.setOutMode(active, change);
-  display.drawOutModeView(active, tracks.getOutMode(active));
+  display.drawOutModeView(active, tracks.getOutMode(active), tracks.getGateLength(active));
 }
 
 void dividerEdit(int change) {
   if (action != EditAction::EditDivider) setEditAction(EditAction::EditDivider);
-  else tracks.setDivider(active, change);
-  display.drawDividerView(active, tracks.getDivider(active), tracks.getDividerType(active));
+  else if (tracks.getDividerType(active) != DividerType::Ratio) tracks.setDivider(active, change);
+  else if (ratioControl == RatioControl::RatioSteps) tracks.setRatioSteps(active, change);
+  else tracks.setRatioClocks(active, change);
+  dividerView();
+}
+
+void dividerView() {
+  if (tracks.getDividerType(active) == DividerType::Ratio) {
+    display.drawRatioView(active, tracks.getRatioSteps(active), tracks.getRatioClocks(active), ratioControl == RatioControl::RatioSteps);
+  } else {
+    display.drawDividerView(active, tracks.getDivider(active), tracks.getDividerType(active));
+  }
 }
 
 void mutationEdit(int change) {
@@ -297,9 +425,16 @@ void mutationEdit(int change) {
 }
 
 void switchDividerType() {
-  if (action != EditAction::EditDividerType) setEditAction(EditAction::EditDividerType);
-  else tracks.nextDividerType(active);
-  display.drawDividerTypeView(active, tracks.getDividerType(active));
+  if (action != EditAction::EditDividerType) {
+    setEditAction(EditAction::EditDividerType);
+  } else if (tracks.getDividerType(active) == DividerType::Ratio && ratioControl == RatioControl::RatioClocks) {
+    ratioControl = RatioControl::RatioSteps;
+  } else {
+    tracks.nextDividerType(active);
+    ratioControl = RatioControl::RatioClocks;
+  }
+  if (tracks.getDividerType(active) == DividerType::Ratio && ratioControl == RatioControl::RatioSteps) dividerView();
+  else display.drawDividerTypeView(active, tracks.getDividerType(active));
 }
 
 void switchPatternType() {
@@ -315,9 +450,56 @@ void switchMutationSeed() {
 }
 
 void shuffleEdit(int change) {
-  if (action != EditAction::EditShuffle) setEditAction(EditAction::EditShuffle);
+  EditAction current = shuffleAction();
+  if (action != current) setEditAction(current);
+  else if (current == EditAction::EditGroove) tracks.setGroove(active, change);
+  else if (current == EditAction::EditResetMode) resetModeEdit(change);
+  else if (current == EditAction::EditSyncRole) sync.setRole(change);
   else tracks.setShuffle(active, change);
-  display.drawShuffleView(active, tracks.getShuffle(active));
+  shuffleView();
+}
+
+void switchShuffleControl() {
+  if (action == shuffleAction()) {
+    int control = shuffleControl + 1;
+    Utilities::cycle(control, ShuffleControl::ShuffleAmount, ShuffleControl::ShuffleSync);
+    shuffleControl = (ShuffleControl) control;
+  }
+  setEditAction(shuffleAction());
+  shuffleView();
+}
+
+EditAction shuffleAction() {
+  if (shuffleControl == ShuffleControl::ShuffleGroove) return EditAction::EditGroove;
+  if (shuffleControl == ShuffleControl::ShuffleReset) return EditAction::EditResetMode;
+  if (shuffleControl == ShuffleControl::ShuffleSync) return EditAction::EditSyncRole;
+  return EditAction::EditShuffle;
+}
+
+void resetModeEdit(int change) {
+  int mode = resetMode + change;
+  Utilities::bound(mode, ResetMode::Immediate, ResetMode::NextBar);
+  resetMode = (ResetMode) mode;
+}
+
+void shuffleView() {
+  if (shuffleControl == ShuffleControl::ShuffleGroove) {
+    byte offsets[GROOVE_STEPS];
+    for (int step = 0; step < GROOVE_STEPS; ++step) offsets[step] = tracks.getGrooveOffset(tracks.getGroove(active), step);
+    display.drawGrooveView(offsets);
+  } else if (shuffleControl == ShuffleControl::ShuffleReset) {
+    display.drawResetView(resetMode);
+  } else if (shuffleControl == ShuffleControl::ShuffleSync) {
+    display.drawSyncView(sync.getRole());
+  } else {
+    display.drawShuffleView(active, tracks.getShuffle(active));
+  }
+}
+
+void quantiseEdit(int change) {
+  if (action != EditAction::EditQuantise) setEditAction(EditAction::EditQuantise);
+  else tracks.setQuantise(active, change);
+  display.drawQuantiseView(active, tracks.getQuantise(active));
 }
 
 void clockSpeedEdit(int change) {
@@ -333,7 +515,7 @@ void clockWidthEdit(int change) {
 }
 
 void clockMulitplierEdit(int change) {
-  if (action != EditAction::EditClockSpeed) setEditAction(EditAction::EditClockSpeed);
+  if (action != EditAction::EditClockMultiplier) setEditAction(EditAction::EditClockMultiplier);
   else clockGenerator.setMulitplier(change);
   display.drawClockSpeed(clockGenerator.isRunning());
 }
@@ -344,21 +526,103 @@ void startStopClock() {
     if(clockGenerator.isRunning()) clockGenerator.stop();
     else clockGenerator.start();
     clocked = clockGenerator.isRunning();
+    if (!clocked && sync.getRole() == SyncRole::Leader) protocol.sendStop();
   }
   display.drawClockSpeed(clockGenerator.isRunning());
 }
 
 void switchOffBeatOut() {
   if (action != EditAction::EditOffBeatOutput) setEditAction(EditAction::EditOffBeatOutput);
-  else offBeatOut = !offBeatOut;
-  display.drawOffbeatOutput(offBeatOut);
+  else {
+    int logic = offBeatOut ? tracks.getLogic() + 1 : Logic::Inverse;
+    offBeatOut = logic <= Logic::AndNot;
+    if (offBeatOut) tracks.setLogic((Logic) logic, active, (active + 1) % EDIT_TRACKS);
+  }
+  display.drawOffbeatOutput(offBeatOut, tracks.getLogic());
+}
+
+void presetEdit(int change) {
+  if (action != EditAction::EditPreset) setEditAction(EditAction::EditPreset);
+  else {
+    preset += change;
+    Utilities::cycle(preset, 0, PRESET_SLOTS - 1);
+  }
+  display.drawPresetView(preset);
+}
+
+void recallPreset() {
+  if (action != EditAction::EditPreset) setEditAction(EditAction::EditPreset);
+  else tracks.recall(preset);
+  display.drawPresetView(preset);
+}
+
+void storePreset() {
+  if (action != EditAction::EditPreset) setEditAction(EditAction::EditPreset);
+  else tracks.store(preset);
+  display.drawPresetView(preset);
+}
+
+void repeatsEdit(int change) {
+  if (action != EditAction::EditRepeats) setEditAction(EditAction::EditRepeats);
+  else {
+    repeats += change;
+    Utilities::bound(repeats, 1, MAX_REPEATS);
+  }
+  display.drawRepeatsView(repeats);
+}
+
+void chainEdit(int change) {
+  if (action != EditAction::EditChain) setEditAction(EditAction::EditChain);
+  else if (change > 0) tracks.appendChain(active, preset, repeats);
+  else tracks.removeChain(active);
+  display.drawChainView(tracks.getChain(active));
+}
+
+void stepCursorEdit(int change) {
+  if (action != EditAction::EditStep) setEditAction(EditAction::EditStep);
+  else {
+    cursor += change;
+    Utilities::cycle(cursor, 0, tracks.getLength(active));
+  }
+  stepView();
+}
+
+void clearStep() {
+  if (action != EditAction::EditStep) setEditAction(EditAction::EditStep);
+  else tracks.clearStep(active, cursor);
+  stepView();
+}
+
+void ratchetEdit() {
+  if (action != EditAction::EditStep) setEditAction(EditAction::EditStep);
+  else tracks.setRatchet(active, cursor, 1);
+  stepView();
+}
+
+void probabilityEdit(int change) {
+  if (action != EditAction::EditStep) setEditAction(EditAction::EditStep);
+  else tracks.setProbability(active, cursor, change);
+  stepView();
+}
+
+void conditionEdit(int change) {
+  if (action != EditAction::EditStep) setEditAction(EditAction::EditStep);
+  else tracks.setCondition(active, cursor, change);
+  stepView();
+}
+
+void stepView() {
+  Utilities::bound(cursor, 0, tracks.getLength(active));
+  display.drawStepView(cursor, tracks.getProbability(active, cursor), tracks.getCondition(active, cursor), tracks.getRatchet(active, cursor));
 }
 
 void initialiseEditModes() {
   editModes[0] = EditMode{lengthEdit, switchLengthMarker, movePatternCursor, patternEdit, offsetEdit};
   editModes[1] = EditMode{dividerEdit, switchDividerType, playModeEdit, switchPatternType, outModeEdit};
-  editModes[2] = EditMode{shuffleEdit, noActionButton, mutationEdit, switchMutationSeed, noActionEncoder};
+  editModes[2] = EditMode{shuffleEdit, switchShuffleControl, mutationEdit, switchMutationSeed, quantiseEdit};
   editModes[3] = EditMode{clockSpeedEdit, startStopClock, clockWidthEdit, switchOffBeatOut, clockMulitplierEdit};
+  editModes[4] = EditMode{presetEdit, recallPreset, repeatsEdit, storePreset, chainEdit};
+  editModes[5] = EditMode{stepCursorEdit, clearStep, probabilityEdit, ratchetEdit, conditionEdit};
   edit = 0;
 }
 
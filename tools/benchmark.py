@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Maximum clock rate benchmark for the matrix-sequencer over USB serial.
+
+Loads a stress configuration (random play, shuffle, mutation and generated
+patterns on every track), then has the firmware clock itself from timer 1
+at rates that rise in steps. Each stage reports the edges lost by the loop
+and the latency from the edge to the outputs being written. Prints the
+fastest rate without losses within the latency bound, then restores the
+tracks. Needs pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+BAUD = 115200
+SYNC = 0xA5
+REPLY = 0x80
+GET_TRACKS = 1
+SET_TRACKS = 2
+START_BENCHMARK = 8
+GET_BENCHMARK = 9
+TICKS_PER_SECOND = 16000000 // 1024
+TICK_MICROS = 1000000 / TICKS_PER_SECOND
+MIN_PERIOD = 2
+BUCKETS = ['<64us', '64us', '128us', '256us', '512us', '1ms', '2ms', '4ms+']
+STRESS = 'D5B6F00F00A4067214020000FF05406A2447210000F07F00A426721402'
+
+
+def crc16(data):
+  crc = 0xFFFF
+  for value in data:
+    crc ^= value << 8
+    for _ in range(8): crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+  return crc
+
+
+def request(port, command, payload=b''):
+  body = bytes([command, len(payload)]) + payload
+  port.write(bytes([SYNC]) + body + struct.pack('<H', crc16(body)))
+  while True:
+    value = port.read(1)
+    if not value: raise IOError('no reply to command %d' % command)
+    if value[0] != SYNC: continue
+    header = port.read(2)
+    reply = port.read(header[1] + 2)
+    if header[0] == command | REPLY and struct.unpack('<H', reply[-2:])[0] == crc16(header + reply[:-2]): return reply[:-2]
+
+
+def run_stage(port, period, poll):
+  if request(port, START_BENCHMARK, struct.pack('<H', period)) != b'\x00': raise IOError('benchmark refused')
+  while True:
+    time.sleep(poll)
+    reply = request(port, GET_BENCHMARK)
+    running, period, generated, processed, lost, longest = struct.unpack('<BHHHHH', reply[:11])
+    if not running: return generated, processed, lost, longest, list(reply[11:])
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument('port')
+  parser.add_argument('--start', type=float, default=8.0, help='first clock rate in Hz')
+  parser.add_argument('--step', type=float, default=1.125, help='rate increase per stage')
+  parser.add_argument('--latency', type=float, default=2.0, help='latency bound in ms')
+  parser.add_argument('--tracks', default=STRESS, help='tracks in the Get Tracks format as hex')
+  parser.add_argument('--poll', type=float, default=0.05, help='seconds between status requests')
+  args = parser.parse_args()
+
+  port = serial.Serial(args.port, BAUD, timeout=1)
+  time.sleep(2)
+  saved = request(port, GET_TRACKS)
+  request(port, SET_TRACKS, bytes.fromhex(args.tracks))
+  best = None
+  print('%10s %6s %6s %10s  %s' % ('rate Hz', 'edges', 'lost', 'longest us', ' '.join('%6s' % bucket for bucket in BUCKETS)))
+  try:
+    rate = args.start
+    period = round(TICKS_PER_SECOND / rate)
+    while period >= MIN_PERIOD:
+      generated, processed, lost, longest, latencies = run_stage(port, period, args.poll)
+      longest_us = longest * TICK_MICROS
+      print('%10.1f %6d %6d %10.0f  %s' % (TICKS_PER_SECOND / period, generated, lost, longest_us, ' '.join('%6d' % count for count in latencies)))
+      if lost > 0 or longest_us > args.latency * 1000: break
+      best = period
+      rate *= args.step
+      period = min(period - 1, round(TICKS_PER_SECOND / rate))
+  finally:
+    request(port, START_BENCHMARK, struct.pack('<H', 0))
+    request(port, SET_TRACKS, saved)
+  if best is None:
+    print('no rate without lost edges within %.1f ms' % args.latency)
+    return 1
+  print('break even %.1f Hz (%d us period)' % (TICKS_PER_SECOND / best, best * TICK_MICROS))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""Flash and RAM budget report for the matrix-sequencer sketch.
+
+Compiles the sketch with arduino-cli, then reads the linker map, the ELF
+and the gcc stack usage files to print flash, .data, .bss and PROGMEM per
+translation unit, the Display.h glyph tables and the worst case stack
+depth. Exits non-zero when a budget in budget.json is exceeded.
+"""
+
+import argparse
+import collections
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SKETCH = 'matrix-sequencer'
+RETURN_ADDRESS = 2
+SECTION = re.compile(r'^ (\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)$')
+WRAPPED = re.compile(r'^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)$')
+SYMBOL = re.compile(r'^([0-9a-f]+) <(.+)>:$')
+CALL = re.compile(r'\s(r?call|r?jmp)\s.*<([^+>]+)(\+0x[0-9a-f]+)?>')
+GLYPHS = re.compile(r'(?:const|constexpr) uint(?:8|64)_t (\w+)(\[\])?\s+PROGMEM')
+
+
+def compile_sketch(fqbn, build):
+  run(['arduino-cli', 'compile', '--fqbn', fqbn, '--build-path', build,
+       '--build-property', 'compiler.c.extra_flags=-fstack-usage',
+       '--build-property', 'compiler.cpp.extra_flags=-fstack-usage',
+       '--build-property', 'compiler.c.elf.extra_flags=-Wl,-Map,{build.path}/{build.project_name}.map',
+       ROOT])
+
+
+def run(command):
+  return subprocess.run(command, check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+
+def unit(path):
+  name = os.path.basename(path)
+  match = re.search(r'\((.+)\)$', name)
+  if match: return 'core/' + match.group(1)
+  return re.sub(r'\.(c|cpp|ino\.cpp|S)\.o$', '', name)
+
+
+def kind(section):
+  if section.startswith('.progmem'): return 'progmem'
+  if section.startswith('.text') or section.startswith('.vectors') or section.startswith('.init') or section.startswith('.fini'): return 'text'
+  if section.startswith('.data') or section.startswith('.rodata'): return 'data'
+  if section.startswith('.bss') or section.startswith('COMMON'): return 'bss'
+  return None
+
+
+def read_map(path):
+  units = collections.defaultdict(collections.Counter)
+  pending = None
+  inside = False
+  for line in open(path):
+    line = line.rstrip('\n')
+    if line.startswith('Linker script and memory map'): inside = True
+    if not inside: continue
+    match = SECTION.match(line)
+    if match:
+      section, size, source = match.group(1), int(match.group(3), 16), match.group(4)
+    elif pending and WRAPPED.match(line):
+      match = WRAPPED.match(line)
+      section, size, source = pending, int(match.group(2), 16), match.group(3)
+    else:
+      pending = line.strip() if re.match(r'^ \.\S+$', line) else None
+      continue
+    pending = None
+    if size and source.endswith(('.o', '.o)')) and kind(section): units[unit(source)][kind(section)] += size
+  return units
+
+
+def read_glyphs(elf):
+  names = set(match.group(1) for match in GLYPHS.finditer(open(os.path.join(ROOT, 'Display.h')).read()))
+  glyphs = collections.defaultdict(list)
+  for line in run(['avr-nm', '-S', '-C', elf]).splitlines():
+    fields = line.split()
+    if len(fields) == 4 and fields[3] in names: glyphs[fields[3]].append(int(fields[1], 16))
+  return glyphs
+
+
+def signature(name):
+  start, depth = 0, 0
+  for index, character in enumerate(name):
+    if character == '(': break
+    if character == '<': depth += 1
+    elif character == '>': depth -= 1
+    elif character == ' ' and depth == 0: start = index + 1
+  return name[start:]
+
+
+def read_frames(build):
+  frames = {}
+  for path in glob.glob(os.path.join(build, '**', '*.su'), recursive=True):
+    for line in open(path):
+      fields = line.rstrip('\n').split('\t')
+      if len(fields) < 3: continue
+      name = signature(fields[0].split(':', 3)[-1])
+      frames[name] = max(frames.get(name, 0), int(fields[1]))
+      frames.setdefault(name.split('(')[0], frames[name])
+  return frames
+
+
+def read_calls(elf):
+  calls = collections.defaultdict(set)
+  indirect = set()
+  current = None
+  for line in run(['avr-objdump', '-d', '-C', '--no-show-raw-insn', elf]).splitlines():
+    match = SYMBOL.match(line)
+    if match:
+      current = match.group(2)
+      continue
+    if current is None: continue
+    if '\ticall' in line or '\teicall' in line: indirect.add(current)
+    match = CALL.search(line)
+    if match and match.group(2) != current: calls[current].add(match.group(2))
+  return calls, indirect
+
+
+def frame(frames, name):
+  if name in frames: return frames[name]
+  return frames.get(name.split('(')[0])
+
+
+def deepest(name, calls, frames, recursion, path, unknown):
+  size = frame(frames, name)
+  if size is None:
+    unknown.add(name)
+    size = 0
+  size += RETURN_ADDRESS
+  if name in recursion: size *= recursion[name]
+  worst, chain = 0, []
+  for callee in calls.get(name, ()):
+    if callee in path: continue
+    depth, below = deepest(callee, calls, frames, recursion, path | {name}, unknown)
+    if depth > worst: worst, chain = depth, below
+  return size + worst, [name] + chain
+
+
+def report(build, config):
+  elf = os.path.join(build, SKETCH + '.ino.elf')
+  units = read_map(os.path.join(build, SKETCH + '.ino.map'))
+  print('%-24s %8s %8s %8s %8s' % ('unit', 'flash', 'progmem', 'data', 'bss'))
+  totals = collections.Counter()
+  for name, sizes in sorted(units.items(), key=lambda item: -sum(item[1].values())):
+    flash = sizes['text'] + sizes['progmem'] + sizes['data']
+    print('%-24s %8d %8d %8d %8d' % (name, flash, sizes['progmem'], sizes['data'], sizes['bss']))
+    totals.update(sizes)
+    totals['flash'] += flash
+  print('%-24s %8d %8d %8d %8d' % ('total', totals['flash'], totals['progmem'], totals['data'], totals['bss']))
+
+  print('\n%-24s %8s %8s' % ('glyph table', 'bytes', 'copies'))
+  for name, sizes in sorted(read_glyphs(elf).items()):
+    print('%-24s %8d %8d' % (name, sum(sizes), len(sizes)))
+
+  calls, indirect = read_calls(elf)
+  frames = read_frames(build)
+  unknown = set()
+  recursion = config.get('recursion', {})
+  stack, chain = deepest('main', calls, frames, recursion, frozenset(), unknown)
+  vectors = [name for name in calls if name.startswith('__vector_')]
+  interrupt, interrupt_chain = 0, []
+  for vector in vectors:
+    depth, below = deepest(vector, calls, frames, recursion, frozenset(), unknown)
+    if depth > interrupt: interrupt, interrupt_chain = depth, below
+  print('\nstack %d bytes: %s' % (stack, ' > '.join(chain)))
+  print('interrupt %d bytes: %s' % (interrupt, ' > '.join(interrupt_chain)))
+  if indirect: print('indirect calls not followed in: %s' % ', '.join(sorted(indirect)))
+  if unknown: print('no stack usage for: %s' % ', '.join(sorted(unknown)))
+
+  static = totals['data'] + totals['bss']
+  stack += interrupt
+  failures = []
+  if totals['flash'] > config['flash']: failures.append('flash %d > %d' % (totals['flash'], config['flash']))
+  if static > config['static']: failures.append('static ram %d > %d' % (static, config['static']))
+  if stack > config['stack']: failures.append('stack %d > %d' % (stack, config['stack']))
+  if static + stack > config['ram']: failures.append('ram %d > %d' % (static + stack, config['ram']))
+  print('\nflash %d/%d static %d/%d stack %d/%d ram %d/%d' % (totals['flash'], config['flash'], static, config['static'], stack, config['stack'], static + stack, config['ram']))
+  for failure in failures: print('over budget: ' + failure, file=sys.stderr)
+  return 1 if failures else 0
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument('--config', default=os.path.join(ROOT, 'tools', 'budget.json'))
+  parser.add_argument('--build', default=os.path.join(ROOT, 'build'))
+  parser.add_argument('--fqbn')
+  parser.add_argument('--no-compile', action='store_true', help='report on an existing build')
+  args = parser.parse_args()
+  config = json.load(open(args.config))
+  if not args.no_compile: compile_sketch(args.fqbn or config['fqbn'], args.build)
+  return report(args.build, config)
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,226 @@
+// Runs a sync leader and a follower on the host with the firmware's Sync,
+// Protocol, Tracks and ClockGenerator code, linked through a pair of pipes,
+// and measures the phase error of the follower's clock edges.
+//
+// Build from the repository root with
+// g++ -std=c++11 -O2 -pthread -Itools/render -I. tools/link/link.cpp Sync.cpp Protocol.cpp Tracks.cpp ClockGenerator.cpp Monitor.cpp Benchmark.cpp Packer.cpp -o build/link
+
+#include "Tracks.h"
+#include "ClockGenerator.h"
+#include "Monitor.h"
+#include "Benchmark.h"
+#include "Sync.h"
+#include "Protocol.h"
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_SPEED 120
+#define DEFAULT_DELAY 1000
+#define DEFAULT_PASS 500
+#define DEFAULT_SETTLE 2000
+#define STOP_MICROS 1000000UL
+#define TICK_MICROS (1000000UL / TIMER_TICKS_PER_SECOND)
+
+typedef std::chrono::steady_clock WallClock;
+
+struct Options {
+  int seconds;
+  int speed;
+  int delay;
+  int pass;
+  int resets;
+  int stops;
+  int settle;
+};
+
+struct Edge {
+  unsigned long ticks;
+  unsigned long time;
+};
+
+class Unit {
+public:
+  Unit(WallClock::time_point start, int input, int output)
+    : start(start), input(input), output(output) {
+  }
+  void lead(const Options &options, std::vector<Edge> &edges) {
+    attach();
+    alignas(Tracks) byte storage[sizeof(Tracks)] = {0};
+    Tracks &tracks = *new (storage) Tracks();
+    ClockGenerator generator = ClockGenerator();
+    Monitor monitor = Monitor();
+    Benchmark benchmark = Benchmark();
+    Sync sync = Sync();
+    Protocol protocol = Protocol(tracks, generator, monitor, benchmark, sync);
+    sync.setRole(SyncRole::Leader);
+    generator.setSpeed(options.speed - generator.getSpeed());
+    generator.start();
+    unsigned long interval = 60000000UL / generator.getSpeed();
+    unsigned long reset = 0;
+    unsigned long restart = 0;
+    for (unsigned long now = tick(); now < options.seconds * 1000000UL; now = pass(options)) {
+      if (reset != 0 && now >= reset) {
+        tracks.reset();
+        protocol.sendReset(ResetMode::Immediate);
+        reset = 0;
+      }
+      if (restart != 0 && now >= restart) {
+        generator.start();
+        restart = 0;
+      }
+      if (generator.tick() == Signal::Rising) {
+        tracks.stepOn();
+        protocol.sendClock(tracks.getTicks());
+        edges.push_back(Edge{tracks.getTicks(), now});
+        if (options.resets > 0 && tracks.getTicks() % options.resets == 0) reset = now + interval / 2;
+        if (options.stops > 0 && tracks.getTicks() % options.stops == 0) {
+          generator.stop();
+          protocol.sendStop();
+          restart = now + STOP_MICROS;
+        }
+      }
+      protocol.poll();
+    }
+  }
+  void follow(const Options &options, std::vector<Edge> &edges, unsigned long &latency) {
+    attach();
+    alignas(Tracks) byte storage[sizeof(Tracks)] = {0};
+    Tracks &tracks = *new (storage) Tracks();
+    ClockGenerator generator = ClockGenerator();
+    Monitor monitor = Monitor();
+    Benchmark benchmark = Benchmark();
+    Sync sync = Sync();
+    Protocol protocol = Protocol(tracks, generator, monitor, benchmark, sync);
+    sync.setRole(SyncRole::Follower);
+    for (unsigned long now = tick(); now < options.seconds * 1000000UL; now = pass(options)) {
+      if (sync.isResetLatched()) tracks.reset();
+      if (sync.follow(tracks) == Signal::Rising) {
+        tracks.stepOn();
+        edges.push_back(Edge{tracks.getTicks(), now});
+      }
+      protocol.poll();
+    }
+    latency = sync.getLatency() * TICK_MICROS;
+  }
+private:
+  WallClock::time_point start;
+  int input;
+  int output;
+  void attach() {
+    hostReset(1);
+    host().input = input;
+    host().output = output;
+  }
+  unsigned long tick() {
+    host().now = std::chrono::duration_cast<std::chrono::microseconds>(WallClock::now() - start).count();
+    return host().now;
+  }
+  unsigned long pass(const Options &options) {
+    std::this_thread::sleep_for(std::chrono::microseconds(options.pass));
+    return tick();
+  }
+};
+
+void relay(int input, int output, int delay) {
+  byte data[SERIAL_BUFFER];
+  for (ssize_t size = read(input, data, sizeof(data)); size > 0; size = read(input, data, sizeof(data))) {
+    std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    if (write(output, data, size) != size) break;
+  }
+  close(output);
+}
+
+void link(int ends[2], int delay, std::vector<std::thread> &relays) {
+  int sent[2];
+  int received[2];
+  if (pipe(sent) != 0 || pipe(received) != 0) {
+    std::cerr << "link: pipe failed\n";
+    exit(1);
+  }
+  fcntl(received[0], F_SETFL, O_NONBLOCK);
+  relays.push_back(std::thread(relay, sent[0], received[1], delay));
+  ends[0] = received[0];
+  ends[1] = sent[1];
+}
+
+void usage() {
+  std::cerr << "usage: link [-t seconds] [-s bpm] [-d link delay us] [-p loop pass us] [-r reset every clocks] [-k stop every clocks] [-w settle ms]\n";
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  Options options = Options{DEFAULT_SECONDS, DEFAULT_SPEED, DEFAULT_DELAY, DEFAULT_PASS, 0, 0, DEFAULT_SETTLE};
+  for (int index = 1; index < argc; ++index) {
+    std::string argument = argv[index];
+    if (index + 1 >= argc) usage();
+    else if (argument == "-t") options.seconds = atoi(argv[++index]);
+    else if (argument == "-s") options.speed = atoi(argv[++index]);
+    else if (argument == "-d") options.delay = atoi(argv[++index]);
+    else if (argument == "-p") options.pass = atoi(argv[++index]);
+    else if (argument == "-r") options.resets = atoi(argv[++index]);
+    else if (argument == "-k") options.stops = atoi(argv[++index]);
+    else if (argument == "-w") options.settle = atoi(argv[++index]);
+    else usage();
+  }
+  std::vector<std::thread> relays;
+  int down[2];
+  int up[2];
+  link(down, options.delay, relays);
+  link(up, options.delay, relays);
+  std::vector<Edge> leader;
+  std::vector<Edge> follower;
+  unsigned long latency = 0;
+  WallClock::time_point start = WallClock::now();
+  std::thread leading([&]() { Unit(start, up[0], down[1]).lead(options, leader); });
+  std::thread following([&]() { Unit(start, down[0], up[1]).follow(options, follower, latency); });
+  leading.join();
+  following.join();
+  close(down[1]);
+  close(up[1]);
+  for (std::thread &relay : relays) relay.join();
+
+  long window = 30000000L / options.speed;
+  std::vector<bool> used(follower.size(), false);
+  int matched = 0;
+  int missed = 0;
+  long total = 0;
+  long absolute = 0;
+  long worst = 0;
+  for (Edge &edge : leader) {
+    if (edge.time < options.settle * 1000UL) continue;
+    long best = window;
+    size_t closest = follower.size();
+    for (size_t index = 0; index < follower.size(); ++index) {
+      long error = (long)follower[index].time - (long)edge.time;
+      if (!used[index] && follower[index].ticks == edge.ticks && labs(error) < labs(best)) {
+        best = error;
+        closest = index;
+      }
+    }
+    if (closest == follower.size()) {
+      ++missed;
+      continue;
+    }
+    used[closest] = true;
+    ++matched;
+    total += best;
+    absolute += labs(best);
+    if (labs(best) > labs(worst)) worst = best;
+  }
+  int extra = 0;
+  for (size_t index = 0; index < follower.size(); ++index) {
+    if (!used[index] && follower[index].time >= options.settle * 1000UL) ++extra;
+  }
+  std::cout << "link delay " << options.delay << "us, loop pass " << options.pass << "us, " << options.speed << " bpm, " << options.seconds << "s\n";
+  std::cout << "latency estimate " << latency << "us\n";
+  std::cout << "edges " << matched + missed << " matched " << matched << " missed " << missed << " extra " << extra << '\n';
+  if (matched > 0) std::cout << "phase error mean " << total / matched << "us mean abs " << absolute / matched << "us worst " << worst << "us\n";
+  return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef Arduino_h_
+#define Arduino_h_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define F_CPU 16000000UL
+#define PROGMEM
+#define EEPROM_SIZE 1024
+#define SERIAL_BUFFER 64
+#define HOST_PINS 20
+#define HOST_ANALOG 8
+#define HOST_MATRIX_DATA 2
+#define HOST_MATRIX_CLOCK 3
+#define HOST_MATRIX_LOAD 4
+#define HOST_MATRIX_ROWS 8
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define memcpy_P(destination, source, size) memcpy(destination, source, size)
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+typedef uint8_t byte;
+
+struct Host {
+  unsigned long now;
+  uint32_t random;
+  int input;
+  int output;
+  int head;
+  int buffered;
+  byte serial[SERIAL_BUFFER];
+  byte pins[HOST_PINS];
+  int analog[HOST_ANALOG];
+  uint16_t shift;
+  byte matrix[HOST_MATRIX_ROWS];
+  byte eeprom[EEPROM_SIZE];
+};
+
+inline Host &host() {
+  static thread_local Host state;
+  return state;
+}
+
+inline void hostReset(unsigned long seed) {
+  host().now = 0;
+  host().random = seed * 2654435761UL + 1;
+  host().input = -1;
+  host().output = -1;
+  host().head = 0;
+  host().buffered = 0;
+  memset(host().pins, LOW, HOST_PINS);
+  memset(host().analog, 0, sizeof(host().analog));
+  host().shift = 0;
+  memset(host().matrix, 0, HOST_MATRIX_ROWS);
+  memset(host().eeprom, 0xFF, EEPROM_SIZE);
+}
+
+inline unsigned long millis() {
+  return host().now / 1000;
+}
+
+inline unsigned long micros() {
+  return host().now;
+}
+
+inline long random(long howbig) {
+  uint32_t value = host().random;
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  host().random = value;
+  return howbig > 0 ? (value & 0x7FFFFFFF) % howbig : 0;
+}
+
+inline long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline int digitalRead(uint8_t pin) { return pin < HOST_PINS ? host().pins[pin] : LOW; }
+inline int analogRead(uint8_t pin) { return pin < HOST_ANALOG ? host().analog[pin] : 0; }
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  Host &state = host();
+  if (pin >= HOST_PINS) return;
+  bool rising = value && !state.pins[pin];
+  state.pins[pin] = value ? HIGH : LOW;
+  if (rising && pin == HOST_MATRIX_CLOCK) state.shift = (state.shift << 1) | state.pins[HOST_MATRIX_DATA];
+  if (rising && pin == HOST_MATRIX_LOAD && (state.shift >> 8) >= 1 && (state.shift >> 8) <= HOST_MATRIX_ROWS) state.matrix[(state.shift >> 8) - 1] = state.shift & 0xFF;
+}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) {}
+  int available() {
+    Host &state = host();
+    if (state.head == state.buffered && state.input >= 0) {
+      ssize_t size = ::read(state.input, state.serial, SERIAL_BUFFER);
+      state.head = 0;
+      state.buffered = size > 0 ? size : 0;
+    }
+    return state.buffered - state.head;
+  }
+  int read() {
+    return available() > 0 ? host().serial[host().head++] : -1;
+  }
+  int availableForWrite() {
+    return host().output >= 0 ? SERIAL_BUFFER : 0;
+  }
+  size_t write(const uint8_t *data, size_t size) {
+    return host().output >= 0 && ::write(host().output, data, size) > 0 ? size : 0;
+  }
+};
+
+static HardwareSerial Serial __attribute__((unused));
+
+#endif
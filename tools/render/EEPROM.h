@@ -0,0 +1,26 @@
+#ifndef EEPROM_h_
+#define EEPROM_h_
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int address) {
+    return host().eeprom[address];
+  }
+  void update(int address, uint8_t value) {
+    host().eeprom[address] = value;
+  }
+  template<typename T> T &get(int address, T &value) {
+    memcpy(&value, &host().eeprom[address], sizeof(T));
+    return value;
+  }
+  template<typename T> const T &put(int address, const T &value) {
+    memcpy(&host().eeprom[address], &value, sizeof(T));
+    return value;
+  }
+};
+
+static EEPROMClass EEPROM;
+
+#endif
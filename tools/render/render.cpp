@@ -0,0 +1,342 @@
+// Renders sequencer configurations to Standard MIDI Files and CSV on the host
+// using the firmware's Tracks, Shuffle, Output and ClockGenerator code.
+//
+// Build from the repository root with
+// g++ -std=c++11 -O2 -pthread -Itools/render -I. tools/render/render.cpp Tracks.cpp Shuffle.cpp Output.cpp ClockGenerator.cpp Packer.cpp -o build/render
+
+#include "Tracks.h"
+#include "Shuffle.h"
+#include "Output.h"
+#include "ClockGenerator.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define EDIT_TRACKS 3
+#define OFF_BEAT 3
+#define RATCHET_WIDTH 8
+#define TRIGGER_PULSE 20
+#define BAR_CLOCKS 16
+#define DEFAULT_BARS 4
+#define DEFAULT_SPEED 120
+#define OFF_BEAT_CLOCK -1
+#define MICROS 1000UL
+#define TICK_MICROS (1000000UL / TIMER_TICKS_PER_SECOND)
+#define MIDI_DIVISION 1000
+#define MIDI_TEMPO 1000000UL
+#define MIDI_CHANNEL 9
+#define MIDI_VELOCITY 100
+
+#define clockInterval(bpm) (60000L / (bpm))
+#define clockPulse(interval, width) ((interval / 100L) * (width * 3) + 3)
+
+const byte NOTES[OUTPUTS] = {36, 38, 42, 46};
+
+struct Configuration {
+  int speed;
+  int multiplier;
+  int width;
+  int logic;
+  int a;
+  int b;
+  byte data[PRESET_DATA];
+  int size;
+};
+
+struct Edge {
+  unsigned long time;
+  byte output;
+  byte level;
+};
+
+struct Options {
+  int bars;
+  int threads;
+  bool exact;
+  std::string directory;
+};
+
+class Recorder {
+public:
+  Recorder(std::vector<Edge> &edges)
+    : edges(edges), levels{0}, pulses{} {
+  }
+  int signal(unsigned long now, int output, Signal signal, OutMode mode, int step) {
+    int out = outputs[output].signal(signal, mode, step);
+    if (signal == Signal::Rising) {
+      pulses[output].edges = 0;
+      pulses[output].held = false;
+    }
+    if (!pulses[output].held) write(now * MICROS, output, out);
+    return out;
+  }
+  void pulse(unsigned long now, int output, int count, unsigned long period, int width) {
+    uint16_t interval = Timer::ticks(period) / count;
+    uint16_t high = ((unsigned long)interval * width) / PULSE_WIDTHS;
+    if (high > 0) {
+      pulses[output].due = now * MICROS + high * TICK_MICROS;
+      pulses[output].high = high * TICK_MICROS;
+      pulses[output].low = (interval - high) * TICK_MICROS;
+      pulses[output].edges = count * 2 - 1;
+      pulses[output].held = true;
+      write(now * MICROS, output, HIGH);
+    }
+  }
+  void fire(unsigned long now) {
+    for (int output = next(); output >= 0 && pulses[output].due <= now * MICROS; output = next()) {
+      HostPulse &pulse = pulses[output];
+      --pulse.edges;
+      write(pulse.due, output, pulse.edges & 1);
+      pulse.due += pulse.edges & 1 ? pulse.high : pulse.low;
+    }
+  }
+  void close(unsigned long now) {
+    for (int output = 0; output < OUTPUTS; ++output) write(now * MICROS, output, LOW);
+  }
+private:
+  struct HostPulse {
+    unsigned long due;
+    unsigned long high;
+    unsigned long low;
+    int edges;
+    bool held;
+  };
+  std::vector<Edge> &edges;
+  byte levels[OUTPUTS];
+  Output outputs[OUTPUTS];
+  HostPulse pulses[OUTPUTS];
+  int next() {
+    int earliest = -1;
+    for (int output = 0; output < OUTPUTS; ++output) {
+      if (pulses[output].edges > 0 && (earliest < 0 || pulses[output].due < pulses[earliest].due)) earliest = output;
+    }
+    return earliest;
+  }
+  void write(unsigned long time, int output, int level) {
+    if (levels[output] != level) edges.push_back(Edge{time, (byte)output, (byte)level});
+    levels[output] = level;
+  }
+};
+
+class Renderer {
+public:
+  Renderer(Configuration &configuration, unsigned long seed, std::vector<Edge> &edges)
+    : configuration(configuration), recorder(edges), origin(0), interval(0), width(0), releases{0} {
+    hostReset(seed);
+  }
+  void render(int bars, bool exact) {
+    alignas(Tracks) byte storage[sizeof(Tracks)] = {0};
+    Tracks &tracks = *new (storage) Tracks();
+    Shuffle shuffle = Shuffle();
+    ClockGenerator generator = ClockGenerator();
+    generator.setSpeed(configuration.speed - generator.getSpeed());
+    generator.setWidth(configuration.width - generator.getWidth());
+    generator.setMulitplier(configuration.multiplier - generator.getMulitplier());
+    if (configuration.logic != OFF_BEAT_CLOCK) tracks.setLogic((Logic)configuration.logic, configuration.a, configuration.b);
+    tracks.setTracks(configuration.data, configuration.size);
+    tracks.commit();
+    generator.start();
+    interval = clockInterval(generator.getSpeed() * (1L << generator.getMulitplier()));
+    width = clockPulse(interval, generator.getWidth());
+    unsigned long rising = 0;
+    int clocks = 0;
+    for (unsigned long now = 1; clocks <= bars * BAR_CLOCKS; now = exact ? now + 1 : next(now, rising)) {
+      host().now = now * MICROS;
+      recorder.fire(now - origin);
+      Signal signal = generator.tick();
+      if (signal == Signal::Rising) {
+        if (clocks == 0) origin = now;
+        rising = now;
+        ++clocks;
+      }
+      if (clocks > bars * BAR_CLOCKS) break;
+      if (clocks > 0) step(tracks, shuffle, signal, now - origin);
+      tracks.prepare();
+    }
+    recorder.close(host().now / MICROS - origin);
+  }
+private:
+  Configuration &configuration;
+  Recorder recorder;
+  unsigned long origin;
+  unsigned long interval;
+  unsigned long width;
+  unsigned long releases[OUTPUTS];
+  void step(Tracks &tracks, Shuffle &shuffle, Signal signal, unsigned long now) {
+    shuffle.clock(signal);
+    if (signal == Signal::Rising) {
+      tracks.stepOn();
+      for (int track = 0; track <= OFF_BEAT; ++track) {
+        if (!tracks.getStepped(track)) continue;
+        unsigned long delay = tracks.getGrooveDelay(track, shuffle.getPeriod());
+        releases[track] = now + origin + delay + 1;
+        shuffle.delay(track, delay);
+      }
+    }
+    int steps = tracks.getSteps();
+    for (int track = 0; track < EDIT_TRACKS; ++track) step(tracks, shuffle, track, steps, now);
+    if (configuration.logic != OFF_BEAT_CLOCK) step(tracks, shuffle, OFF_BEAT, steps, now);
+    else recorder.signal(now, OFF_BEAT, signal, OutMode::Clock, 1);
+  }
+  void step(Tracks &tracks, Shuffle &shuffle, int track, int steps, unsigned long now) {
+    int step = bitRead(steps, track);
+    Signal signal = shuffle.tick(track);
+    if (!tracks.getStepped(track) && !shuffle.isDelayed(track)) signal = Signal::Low;
+    int output = recorder.signal(now, track, signal, tracks.getOutMode(track), step);
+    if (output && signal == Signal::Rising && track < EDIT_TRACKS) pulse(tracks, shuffle, track, now);
+  }
+  void pulse(Tracks &tracks, Shuffle &shuffle, int track, unsigned long now) {
+    unsigned long period = shuffle.getPeriod();
+    int ratchet = tracks.getRatchet(track);
+    if (period > 0 && tracks.getOutMode(track) == OutMode::Length) recorder.pulse(now, track, ratchet, tracks.getStepPeriod(track, period), tracks.getGateLength(track));
+    else if (period > 0 && ratchet > 1) recorder.pulse(now, track, ratchet, period, RATCHET_WIDTH);
+  }
+  unsigned long next(unsigned long now, unsigned long rising) {
+    unsigned long after = rising + interval + 1;
+    if (rising == 0) return after;
+    earliest(after, now, rising + 1);
+    earliest(after, now, rising + width);
+    earliest(after, now, rising + TRIGGER_PULSE);
+    for (int track = 0; track <= OFF_BEAT; ++track) {
+      earliest(after, now, releases[track]);
+      earliest(after, now, releases[track] + 1);
+      earliest(after, now, releases[track] + TRIGGER_PULSE);
+      earliest(after, now, releases[track] + width);
+    }
+    return after;
+  }
+  void earliest(unsigned long &after, unsigned long now, unsigned long time) {
+    if (time > now && time < after) after = time;
+  }
+};
+
+void writeVariable(std::string &track, unsigned long value) {
+  byte bytes[4];
+  int count = 0;
+  do {
+    bytes[count++] = value & 0x7F;
+    value >>= 7;
+  } while (value > 0 && count < 4);
+  while (count > 0) {
+    --count;
+    track.push_back(bytes[count] | (count > 0 ? 0x80 : 0));
+  }
+}
+
+void writeWord(std::string &data, unsigned long value, int bytes) {
+  for (int index = bytes - 1; index >= 0; --index) data.push_back((value >> (8 * index)) & 0xFF);
+}
+
+std::string midi(std::vector<Edge> &edges) {
+  std::string track;
+  writeVariable(track, 0);
+  track += std::string("\xFF\x51\x03", 3);
+  writeWord(track, MIDI_TEMPO, 3);
+  unsigned long last = 0;
+  for (Edge &edge : edges) {
+    unsigned long time = (edge.time + MICROS / 2) / MICROS;
+    writeVariable(track, time - last);
+    track.push_back((edge.level ? 0x90 : 0x80) | MIDI_CHANNEL);
+    track.push_back(NOTES[edge.output]);
+    track.push_back(edge.level ? MIDI_VELOCITY : 0);
+    last = time;
+  }
+  writeVariable(track, 0);
+  track += std::string("\xFF\x2F\x00", 3);
+  std::string file("MThd", 4);
+  writeWord(file, 6, 4);
+  writeWord(file, 0, 2);
+  writeWord(file, 1, 2);
+  writeWord(file, MIDI_DIVISION, 2);
+  file += "MTrk";
+  writeWord(file, track.size(), 4);
+  return file + track;
+}
+
+std::string csv(std::vector<Edge> &edges) {
+  std::ostringstream out;
+  out << "micros,output,level\n";
+  for (Edge &edge : edges) out << edge.time << ',' << edge.output + 1 << ',' << (int)edge.level << '\n';
+  return out.str();
+}
+
+std::string summary(int index, std::vector<Edge> &edges) {
+  int counts[OUTPUTS] = {0};
+  for (Edge &edge : edges) if (edge.level) ++counts[edge.output];
+  std::ostringstream out;
+  out << index;
+  for (int output = 0; output < OUTPUTS; ++output) out << ',' << counts[output];
+  return out.str();
+}
+
+void save(const std::string &path, const std::string &data) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(data.data(), data.size());
+}
+
+bool parse(const std::string &line, Configuration &configuration) {
+  std::istringstream in(line);
+  std::string hex;
+  configuration = Configuration{DEFAULT_SPEED, 0, 0, Logic::Inverse, 0, 1, {0}, 0};
+  in >> configuration.speed >> configuration.multiplier >> configuration.width >> configuration.logic >> configuration.a >> configuration.b >> hex;
+  if (in.fail() || hex.size() % 2 != 0 || hex.size() / 2 != TRACKS_DATA) return false;
+  for (size_t index = 0; index < hex.size(); index += 2) configuration.data[configuration.size++] = strtoul(hex.substr(index, 2).c_str(), nullptr, 16);
+  return configuration.size > 0 && configuration.logic >= OFF_BEAT_CLOCK && configuration.logic <= Logic::AndNot;
+}
+
+void usage() {
+  std::cerr << "usage: render [-b bars] [-j threads] [-o directory] [-x] [configurations]\n";
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  Options options = Options{DEFAULT_BARS, (int)std::thread::hardware_concurrency(), false, "."};
+  std::ifstream file;
+  for (int index = 1; index < argc; ++index) {
+    std::string argument = argv[index];
+    if (argument == "-b" && index + 1 < argc) options.bars = atoi(argv[++index]);
+    else if (argument == "-j" && index + 1 < argc) options.threads = atoi(argv[++index]);
+    else if (argument == "-o" && index + 1 < argc) options.directory = argv[++index];
+    else if (argument == "-x") options.exact = true;
+    else if (argument[0] == '-' || file.is_open()) usage();
+    else file.open(argument);
+  }
+  std::istream &in = file.is_open() ? file : std::cin;
+  std::vector<Configuration> configurations;
+  std::string line;
+  for (int number = 1; std::getline(in, line); ++number) {
+    if (line.empty() || line[0] == '#') continue;
+    Configuration configuration;
+    if (!parse(line, configuration)) {
+      std::cerr << "line " << number << ": invalid configuration\n";
+      return 1;
+    }
+    configurations.push_back(configuration);
+  }
+  std::vector<std::string> summaries(configurations.size());
+  std::atomic<size_t> pending(0);
+  std::vector<std::thread> workers;
+  for (int worker = 0; worker < (options.threads > 0 ? options.threads : 1); ++worker) {
+    workers.push_back(std::thread([&]() {
+      std::vector<Edge> edges;
+      for (size_t index = pending++; index < configurations.size(); index = pending++) {
+        edges.clear();
+        Renderer(configurations[index], index + 1, edges).render(options.bars, options.exact);
+        std::string path = options.directory + "/" + std::to_string(index);
+        save(path + ".mid", midi(edges));
+        save(path + ".csv", csv(edges));
+        summaries[index] = summary(index, edges);
+      }
+    }));
+  }
+  for (std::thread &worker : workers) worker.join();
+  for (std::string &line : summaries) std::cout << line << '\n';
+  return 0;
+}
@@ -0,0 +1,562 @@
+// Host checks for the firmware sources, built against the mock Arduino core
+// in tools/render. Exits with the number of failed checks.
+//
+// Build and run from the repository root with
+// g++ -std=c++11 -O2 -pthread -Itools/render -I. tools/test/test.cpp Display.cpp Buttons.cpp Tracks.cpp Shuffle.cpp Packer.cpp Protocol.cpp Sync.cpp ClockGenerator.cpp Monitor.cpp Benchmark.cpp -o build/test && build/test
+
+#include "Display.h"
+#include "Buttons.h"
+#include "Tracks.h"
+#include "Shuffle.h"
+#include "Packer.h"
+#include "Protocol.h"
+#include "Utilities.h"
+#include <EEPROM.h>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+
+#define MILLIS 1000UL
+#define MATRIX_ROWS 8
+#define RECORD_MAGIC 0x4D
+#define RECORD_VERSION 113
+#define GROOVE_RECORD_VERSION 112
+#define RECORD_ADDRESS 256
+#define PROTOCOL_SYNC 0xA5
+#define PROTOCOL_REPLY 0x80
+#define PROTOCOL_ERROR 0x7F
+#define MESSAGE_SIZE (FRAME_PAYLOAD + 5)
+
+int failures = 0;
+
+void check(bool condition, const char *name) {
+  if (!condition) {
+    std::cerr << "FAIL " << name << '\n';
+    ++failures;
+  }
+}
+
+void advance(unsigned long ms) {
+  host().now += ms * MILLIS;
+}
+
+bool shows(uint64_t image) {
+  for (int row = 0; row < MATRIX_ROWS; ++row) {
+    if (host().matrix[row] != ((image >> (row * 8)) & 0xFF)) return false;
+  }
+  return true;
+}
+
+void render(Display &display) {
+  for (int pass = 0; pass < MATRIX_ROWS; ++pass) display.render();
+}
+
+void testDisplay() {
+  hostReset(1);
+  Display display = Display();
+  display.initialise();
+  advance(20);
+  render(display);
+  check(shows(INVERSE_SMILE), "display boots on the inverse smile");
+  advance(100);
+  render(display);
+  check(shows(SMILE), "display boot alternates to the smile");
+  advance(1000);
+  render(display);
+  advance(20);
+  display.drawResetView(ResetMode::NextBar);
+  render(display);
+  check(shows(RESET_MODES[ResetMode::NextBar]), "display shows a frame after booting");
+}
+
+void testButtons() {
+  hostReset(1);
+  Buttons buttons = Buttons();
+  buttons.initialise();
+  host().analog[2] = 300;
+  ButtonEvent event = buttons.event();
+  check(event.state == ButtonState::Released, "button press waits for release or hold");
+  advance(50);
+  host().analog[2] = 0;
+  event = buttons.event();
+  check(event.control == Control::One && event.state == ButtonState::Clicked, "button one clicks on release");
+  host().analog[2] = 500;
+  buttons.event();
+  advance(600);
+  event = buttons.event();
+  check(event.control == Control::Three && event.state == ButtonState::Held, "button three holds");
+  event = buttons.event();
+  check(event.control == Control::Three && event.state == ButtonState::Released, "button hold is reported once");
+}
+
+Tracks &fresh(byte storage[]) {
+  hostReset(1);
+  memset(storage, 0, sizeof(Tracks));
+  return *new (storage) Tracks();
+}
+
+void step(Tracks &tracks, int clocks) {
+  for (int clock = 0; clock < clocks; ++clock) {
+    tracks.prepare();
+    tracks.stepOn();
+  }
+}
+
+void testMutationEdit() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.setPatternWord(0, 0x00FF);
+  step(tracks, 1);
+  tracks.prepare();
+  tracks.setMutation(0, 37);
+  step(tracks, 16);
+  check(tracks.getPattern(0) == 0xFF00, "mutation edit applies to the next loop");
+  tracks.nextMutationSeed(0);
+  step(tracks, 16);
+  check(tracks.getPattern(0) == 0x00FF, "mutation seed edit applies to the next loop");
+}
+
+void packTrack(Packer &packer, int start, int end, int length, int density, int offset, int divider, int dividerType, int version = RECORD_VERSION) {
+  packer.write(0xA5A5, 16);
+  packer.write(start, 4);
+  packer.write(end, 4);
+  packer.write(length, 4);
+  packer.write(density, 4);
+  packer.write(offset, 4);
+  packer.write(divider, 3);
+  packer.write(0, 4);
+  packer.write(63, 6);
+  packer.write(PlayMode::Pendulum, 2);
+  packer.write(0, 2);
+  packer.write(0, 2);
+  packer.write(dividerType, 2);
+  packer.write(3, 2);
+  packer.write(0, 1);
+  packer.write(0, 4);
+  packer.write(0, 4);
+  if (version >= RECORD_VERSION) {
+    packer.write(15, 4);
+    packer.write(3, 4);
+  }
+}
+
+bool bounded(Tracks &tracks) {
+  byte data[PRESET_DATA] = {0};
+  tracks.getTracks(data);
+  Packer packer(data);
+  bool valid = true;
+  for (int track = 0; track < 3; ++track) {
+    packer.read(16);
+    int start = packer.read(4);
+    int end = packer.read(4);
+    int length = packer.read(4);
+    int density = packer.read(4);
+    int offset = packer.read(4);
+    int divider = packer.read(3);
+    packer.read(4);
+    int mutation = packer.read(6);
+    packer.read(6);
+    int dividerType = packer.read(2);
+    int seed = packer.read(2);
+    packer.read(5);
+    int groove = packer.read(4);
+    int steps = packer.read(4) + 1;
+    int clocks = packer.read(4) + 1;
+    int maxDivider = dividerType == DividerType::Beat ? 6 : dividerType == DividerType::Triplet ? 7 : 0;
+    valid = valid && steps <= clocks && tracks.getRatioSteps(track) == steps && tracks.getRatioClocks(track) == clocks && start <= end && offset <= length && (density <= length || tracks.getPatternType(track) == PatternType::Automaton)
+      && dividerType <= DividerType::Ratio && divider <= maxDivider && mutation <= 37 && seed <= MutationSeed::LastInverted && groove < GROOVES
+      && tracks.getLength(track) <= 15 && tracks.getPosition(track) <= 15 && tracks.getStart(track) == start && tracks.getEnd(track) == end;
+  }
+  return valid;
+}
+
+void testSetTracksBounds() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  byte data[PRESET_DATA] = {0};
+  Packer packer(data);
+  packTrack(packer, 12, 3, 15, 15, 15, 7, DividerType::Beat);
+  packTrack(packer, 0, 15, 4, 15, 15, 7, 3);
+  packTrack(packer, 15, 15, 0, 0, 0, 0, DividerType::Triplet);
+  check(packer.size() == TRACKS_DATA && tracks.getTracks(data) == TRACKS_DATA, "set tracks frame matches get tracks");
+  packer = Packer(data);
+  packTrack(packer, 12, 3, 15, 15, 15, 7, DividerType::Beat);
+  packTrack(packer, 0, 15, 4, 15, 15, 7, 3);
+  packTrack(packer, 15, 15, 0, 0, 0, 0, DividerType::Triplet);
+  check(tracks.setTracks(data, packer.size()), "set tracks accepts a full frame");
+  step(tracks, 40);
+  check(tracks.getStart(0) <= tracks.getEnd(0), "set tracks bounds the start to the end");
+  check(tracks.getLength(0) == 0 && tracks.getLength(2) == 0, "set tracks keeps lengths in range");
+  check(tracks.getDividerType(1) == DividerType::Ratio, "set tracks bounds the divider type");
+  check(tracks.getRatioSteps(1) == 4 && tracks.getRatioClocks(1) == 4, "set tracks refuses more steps than clocks");
+  check(tracks.getMutation(0) <= 37 && tracks.getMutationSeed(0) == MutationSeed::LastInverted, "set tracks bounds mutation");
+  byte before[PRESET_DATA] = {0};
+  byte after[PRESET_DATA] = {0};
+  tracks.getTracks(before);
+  for (int index = 0; index < (int)PRESET_DATA; ++index) data[index] = ~before[index];
+  bool refused = !tracks.setTracks(data, TRACKS_DATA - 1) && !tracks.setTracks(data, TRACKS_DATA + 1) && !tracks.setTracks(data, 0);
+  step(tracks, 1);
+  tracks.commit();
+  tracks.getTracks(after);
+  check(refused && memcmp(before, after, TRACKS_DATA) == 0, "set tracks refuses other lengths and keeps the tracks");
+  int invalid = 0;
+  for (int frame = 0; frame < 2000; ++frame) {
+    for (int index = 0; index < (int)PRESET_DATA; ++index) data[index] = random(256);
+    tracks.setTracks(data, random(8) ? TRACKS_DATA : random(PRESET_DATA));
+    step(tracks, 1 + random(40));
+    if (!bounded(tracks)) ++invalid;
+  }
+  check(invalid == 0, "set tracks keeps random frames in bounds");
+}
+
+void writePreset(int slot, byte data[], int size, byte version = RECORD_VERSION) {
+  SettingsHeader header = {RECORD_MAGIC, version, (byte)size, Utilities::crc16(data, size)};
+  int address = RECORD_ADDRESS + slot * PRESET_SIZE;
+  EEPROM.put(address, header);
+  for (int index = 0; index < size; ++index) EEPROM.update(address + sizeof(header) + index, data[index]);
+}
+
+void testPresetBounds() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  byte data[PRESET_DATA] = {0};
+  Packer packer(data);
+  for (int track = 0; track < 3; ++track) packTrack(packer, 14, 2, 15, 15, 15, 7, 3);
+  writePreset(3, data, packer.size());
+  tracks.recall(3);
+  step(tracks, 40);
+  check(tracks.getStart(0) <= tracks.getEnd(0) && tracks.getDividerType(0) == DividerType::Ratio, "recalled preset is bounded");
+  tracks.appendChain(1, 3, 1);
+  tracks.appendChain(1, 3, 2);
+  step(tracks, 200);
+  check(tracks.getStart(1) <= tracks.getEnd(1), "chained preset is bounded");
+  int invalid = 0;
+  for (int record = 0; record < 500; ++record) {
+    for (int index = 0; index < (int)PRESET_DATA; ++index) data[index] = random(256);
+    writePreset(record % 16, data, PRESET_DATA);
+    if (record % 2) tracks.recall(record % 16);
+    step(tracks, 1 + random(40));
+    if (!bounded(tracks)) ++invalid;
+  }
+  check(invalid == 0, "presets keep random records in bounds");
+}
+
+void testRatioDivider() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.nextDividerType(0);
+  tracks.nextDividerType(0);
+  tracks.setRatioClocks(0, 4);
+  tracks.setRatioSteps(0, 3);
+  check(tracks.getRatioSteps(0) == 5 && tracks.getRatioClocks(0) == 7, "ratio steps and clocks are set per track");
+  int stepped = 0;
+  for (int clock = 0; clock < 70; ++clock) {
+    step(tracks, 1);
+    if (tracks.getStepped(0)) ++stepped;
+  }
+  check(stepped == 50, "ratio track steps 5 times every 7 clocks");
+  tracks.setRatioClocks(0, -5);
+  check(tracks.getRatioClocks(0) == 5, "ratio clocks stay at least the steps");
+  tracks.setRatioSteps(0, 4);
+  check(tracks.getRatioSteps(0) == 5, "ratio steps stay at most the clocks");
+  tracks.setRatioClocks(0, 20);
+  check(tracks.getRatioClocks(0) == 16, "ratio clocks stay at most 16");
+}
+
+void testRatioMigration() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  byte data[PRESET_DATA] = {0};
+  Packer packer(data);
+  packTrack(packer, 0, 15, 15, 0, 0, 2, DividerType::Ratio, GROOVE_RECORD_VERSION);
+  packTrack(packer, 0, 15, 15, 0, 0, 7, DividerType::Ratio, GROOVE_RECORD_VERSION);
+  packTrack(packer, 0, 15, 15, 0, 0, 2, DividerType::Beat, GROOVE_RECORD_VERSION);
+  writePreset(5, data, packer.size(), GROOVE_RECORD_VERSION);
+  tracks.recall(5);
+  step(tracks, 16);
+  check(tracks.getRatioSteps(0) == 4 && tracks.getRatioClocks(0) == 5, "older presets keep their ratio as steps and clocks");
+  check(tracks.getRatioSteps(1) == 7 && tracks.getRatioClocks(1) == 8, "older presets keep the last ratio");
+  check(tracks.getDividerType(2) == DividerType::Beat && tracks.getDivider(2) == 2, "older presets keep beat dividers");
+}
+
+void testTuringLock() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.nextPatternType(0);
+  tracks.nextPatternType(0);
+  tracks.setDensity(0, 15);
+  step(tracks, 16);
+  int locked = tracks.getPattern(0);
+  step(tracks, 64);
+  check(tracks.getPattern(0) == locked, "locked turing register repeats");
+  tracks.setDensity(0, -15);
+  check(tracks.getPattern(0) == locked, "turning the lock keeps the register");
+  int changed = 0;
+  for (int loop = 0; loop < 8; ++loop) {
+    int last = tracks.getPattern(0);
+    step(tracks, 16);
+    if (tracks.getPattern(0) != last) ++changed;
+  }
+  check(changed > 0, "unlocked turing register changes");
+}
+
+void testRecallTiming() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.setPatternWord(0, 0x0F0F);
+  tracks.setPatternWord(1, 0x0F0F);
+  tracks.setQuantise(1, 1);
+  tracks.store(2);
+  tracks.setPatternWord(0, 0x00FF);
+  tracks.setPatternWord(1, 0x00FF);
+  step(tracks, 4);
+  tracks.recall(2);
+  check(tracks.getPattern(0) == 0x00FF && tracks.getPattern(1) == 0x00FF, "recall waits for the clock");
+  step(tracks, 1);
+  check(tracks.getPattern(0) == 0x0F0F && tracks.getPattern(1) == 0x00FF && tracks.getPosition(0) == 4, "recall applies on the next clock");
+  step(tracks, 11);
+  check(tracks.getPattern(1) == 0x00FF, "quantised recall waits for the loop");
+  step(tracks, 1);
+  check(tracks.getPattern(1) == 0x0F0F && tracks.getPosition(1) == 0, "quantised recall applies on the next loop");
+  tracks.recall(2);
+  step(tracks, 16);
+  check(tracks.getPattern(0) == 0x0F0F && tracks.getPattern(1) == 0x0F0F, "recalling the playing preset keeps the patterns");
+}
+
+void configure(Tracks &tracks, int mode) {
+  for (int track = 0; track < 3; ++track) {
+    tracks.setPatternWord(track, 0xB5AD ^ (track * 0x1111));
+    tracks.setEnd(track, -(track * 3 + 4));
+    tracks.setPlayMode(track, mode);
+    for (int step = 0; step < 16; step += 3) tracks.setCondition(track, step, 3);
+    tracks.setCondition(track, 1, 4);
+  }
+  tracks.nextDividerType(2);
+  tracks.nextDividerType(2);
+  tracks.setDivider(2, 3);
+  tracks.setDivider(1, 1);
+}
+
+void testSeekMatchesPlay() {
+  for (int mode = PlayMode::Forward; mode <= PlayMode::Random; ++mode) {
+    alignas(Tracks) byte playing[sizeof(Tracks)];
+    alignas(Tracks) byte seeking[sizeof(Tracks)];
+    Tracks &played = fresh(playing);
+    configure(played, mode);
+    Tracks &sought = fresh(seeking);
+    configure(sought, mode);
+    int mismatches = 0;
+    for (int tick = 1; tick <= 400; ++tick) {
+      step(played, 1);
+      sought.seek(tick);
+      for (int track = 0; track < 3; ++track) {
+        if (played.getPosition(track) != sought.getPosition(track) || played.getStep(track) != sought.getStep(track)) ++mismatches;
+      }
+    }
+    check(mismatches == 0, mode == PlayMode::Forward ? "seek matches play forward" : mode == PlayMode::Backward ? "seek matches play backward"
+      : mode == PlayMode::Pendulum ? "seek matches play pendulum" : "seek matches play random");
+  }
+}
+
+void testChainRepeats() {
+  const int expected[] = {0x00F1, 0x00F1, 0x0F03, 0x0F03, 0x0F03, 0x00F1, 0x00F1, 0x0F03, 0x0F03, 0x0F03};
+  for (int mode = PlayMode::Forward; mode <= PlayMode::Pendulum; mode += PlayMode::Pendulum) {
+    alignas(Tracks) byte storage[sizeof(Tracks)];
+    Tracks &tracks = fresh(storage);
+    tracks.setPlayMode(0, mode);
+    tracks.setPatternWord(0, 0x00F1);
+    tracks.store(0);
+    tracks.setPatternWord(0, 0x0F03);
+    tracks.store(1);
+    tracks.appendChain(0, 0, 2);
+    tracks.appendChain(0, 1, 3);
+    tracks.reset();
+    step(tracks, 1);
+    int period = mode == PlayMode::Pendulum ? 32 : 16;
+    bool matched = true;
+    for (int loop = 0; loop < 10; ++loop) {
+      if (tracks.getPattern(0) != expected[loop]) matched = false;
+      step(tracks, period);
+    }
+    check(matched, mode == PlayMode::Pendulum ? "chain repeats pendulum loops" : "chain repeats forward loops");
+  }
+}
+
+void chain(Tracks &tracks) {
+  tracks.appendChain(0, 0, 2);
+  tracks.appendChain(0, 1, 3);
+  tracks.reset();
+}
+
+void testChainSeek() {
+  alignas(Tracks) byte playing[sizeof(Tracks)];
+  alignas(Tracks) byte seeking[sizeof(Tracks)] = {0};
+  Tracks &played = fresh(playing);
+  played.setPatternWord(0, 0x00F1);
+  played.store(0);
+  played.setPatternWord(0, 0x0F03);
+  played.store(1);
+  chain(played);
+  Tracks &sought = *new (seeking) Tracks();
+  chain(sought);
+  int mismatches = 0;
+  for (int tick = 1; tick <= 200; ++tick) {
+    step(played, 1);
+    sought.seek(tick);
+    if (played.getPattern(0) != sought.getPattern(0) || played.getPosition(0) != sought.getPosition(0)) ++mismatches;
+  }
+  check(mismatches == 0, "seek follows the chain");
+  sought.seek(49);
+  for (int tick = 50; tick <= 200; ++tick) step(sought, 1);
+  check(played.getPattern(0) == sought.getPattern(0) && played.getPosition(0) == sought.getPosition(0), "play carries the chain on after a seek");
+  sought.seek(0);
+  step(sought, 1);
+  check(sought.getPattern(0) == 0x00F1 && sought.getPosition(0) == 0, "seek to the start restarts the chain");
+}
+
+void testResetStartsOnStepZero() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.setPatternWord(0, 0x0001);
+  tracks.nextDividerType(1);
+  tracks.setDivider(1, 1);
+  step(tracks, 1);
+  check(tracks.getPosition(0) == 0 && tracks.getStepped(0) && (tracks.getSteps() & 1), "first clock plays step zero");
+  step(tracks, 22);
+  tracks.reset();
+  step(tracks, 1);
+  check(tracks.getPosition(0) == 0 && tracks.getPosition(1) == 0 && tracks.getStepped(1), "first clock after a reset plays step zero");
+  step(tracks, 15);
+  check(tracks.getPosition(0) == 15 && tracks.getTicks() % 16 == 0, "a bar of clocks ends on the last step");
+  step(tracks, 1);
+  check(tracks.getPosition(0) == 0, "the next bar starts on step zero");
+}
+
+void testDividedGroove() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  tracks.setDivider(0, 2);
+  tracks.setShuffle(0, 15);
+  step(tracks, 5);
+  check(tracks.getGrooveDelay(0, 100) == 125, "groove delay scales with the divided step");
+  Shuffle shuffle = Shuffle();
+  advance(1000);
+  shuffle.clock(Signal::Rising);
+  advance(50);
+  shuffle.clock(Signal::Low);
+  advance(50);
+  shuffle.clock(Signal::Rising);
+  shuffle.delay(0, 125);
+  bool waited = shuffle.tick(0) == Signal::Low;
+  advance(50);
+  shuffle.clock(Signal::Low);
+  advance(50);
+  shuffle.clock(Signal::Rising);
+  waited = waited && shuffle.tick(0) == Signal::Low && shuffle.isDelayed(0);
+  advance(26);
+  shuffle.clock(Signal::High);
+  check(waited && shuffle.tick(0) == Signal::Rising, "delayed step is released after the next clock");
+  advance(49);
+  bool held = shuffle.tick(0) == Signal::High;
+  advance(1);
+  check(held && shuffle.tick(0) == Signal::Low && !shuffle.isDelayed(0), "released step is held for the clock width");
+}
+
+int frame(byte message[], byte command, const byte payload[], int length) {
+  message[0] = PROTOCOL_SYNC;
+  message[1] = command;
+  message[2] = length;
+  for (int index = 0; index < length; ++index) message[3 + index] = payload[index];
+  uint16_t crc = Utilities::crc16(&message[1], length + 2);
+  message[3 + length] = lowByte(crc);
+  message[4 + length] = highByte(crc);
+  return length + 5;
+}
+
+int exchange(Protocol &protocol, const byte request[], int size, byte reply[]) {
+  int in[2];
+  int out[2];
+  if (pipe(in) != 0 || pipe(out) != 0) return -1;
+  fcntl(in[0], F_SETFL, O_NONBLOCK);
+  fcntl(out[0], F_SETFL, O_NONBLOCK);
+  ssize_t written = write(in[1], request, size);
+  host().input = in[0];
+  host().output = out[1];
+  for (int pass = 0; pass < 2 * MESSAGE_SIZE; ++pass) protocol.poll();
+  ssize_t received = read(out[0], reply, 2 * MESSAGE_SIZE);
+  host().input = -1;
+  host().output = -1;
+  close(in[0]);
+  close(in[1]);
+  close(out[0]);
+  close(out[1]);
+  return written == size && received > 0 ? received : 0;
+}
+
+bool replies(Protocol &protocol, const byte request[], int size, byte command, const byte payload[], int length) {
+  byte expected[MESSAGE_SIZE];
+  byte reply[2 * MESSAGE_SIZE];
+  int expectedSize = frame(expected, command | PROTOCOL_REPLY, payload, length);
+  return exchange(protocol, request, size, reply) == expectedSize && memcmp(reply, expected, expectedSize) == 0;
+}
+
+void testProtocol() {
+  alignas(Tracks) byte storage[sizeof(Tracks)];
+  Tracks &tracks = fresh(storage);
+  ClockGenerator clock = ClockGenerator();
+  Monitor monitor = Monitor();
+  Benchmark benchmark = Benchmark();
+  Sync sync = Sync();
+  Protocol protocol = Protocol(tracks, clock, monitor, benchmark, sync);
+  byte request[2 * MESSAGE_SIZE];
+  byte reply[2 * MESSAGE_SIZE];
+  byte ok = 0;
+  byte error = PROTOCOL_ERROR;
+  byte settings[4] = {(byte)clock.getSpeed(), (byte)clock.getWidth(), (byte)clock.getMulitplier(), (byte)clock.isRunning()};
+  int size = frame(request, ProtocolCommand::GetClock, NULL, 0);
+  check(replies(protocol, request, size, ProtocolCommand::GetClock, settings, 4), "protocol answers get clock");
+  byte patterns[6] = {0x34, 0x12, 0x78, 0x56, 0xBC, 0x9A};
+  size = frame(request, ProtocolCommand::SetPatterns, patterns, 6);
+  request[size - 1] ^= 0xFF;
+  check(exchange(protocol, request, size, reply) == 0 && tracks.getPatternWord(0) == 0, "protocol ignores a frame with a bad crc");
+  size = frame(request, ProtocolCommand::SetPatterns, patterns, 6);
+  check(replies(protocol, request, size, ProtocolCommand::SetPatterns, &ok, 1) && tracks.getPatternWord(1) == 0x5678, "protocol sets patterns");
+  size = frame(request, ProtocolCommand::GetPatterns, NULL, 0);
+  check(replies(protocol, request, size, ProtocolCommand::GetPatterns, patterns, 6), "protocol gets patterns");
+  size = frame(request, ProtocolCommand::SetPatterns, patterns, 6);
+  request[2] = FRAME_PAYLOAD + 1;
+  size += frame(&request[size], ProtocolCommand::GetClock, NULL, 0);
+  check(replies(protocol, request, size, ProtocolCommand::GetClock, settings, 4), "protocol drops a frame with a bad length and resyncs");
+  size = frame(request, 0x30, NULL, 0);
+  check(replies(protocol, request, size, 0x30, &error, 1), "protocol refuses an unknown command");
+  byte data[PRESET_DATA] = {0};
+  int length = tracks.getTracks(data);
+  size = frame(request, ProtocolCommand::SetTracks, data, length - 1);
+  check(replies(protocol, request, size, ProtocolCommand::SetTracks, &error, 1), "protocol refuses a short set tracks frame");
+  data[0] ^= 0x5A;
+  size = frame(request, ProtocolCommand::SetTracks, data, length);
+  check(replies(protocol, request, size, ProtocolCommand::SetTracks, &ok, 1), "protocol sets tracks");
+  tracks.commit();
+  size = frame(request, ProtocolCommand::GetTracks, NULL, 0);
+  check(replies(protocol, request, size, ProtocolCommand::GetTracks, data, length), "protocol gets tracks");
+}
+
+int main() {
+  testDisplay();
+  testButtons();
+  testMutationEdit();
+  testSetTracksBounds();
+  testPresetBounds();
+  testRatioDivider();
+  testRatioMigration();
+  testTuringLock();
+  testRecallTiming();
+  testSeekMatchesPlay();
+  testChainRepeats();
+  testResetStartsOnStepZero();
+  testChainSeek();
+  testDividedGroove();
+  testProtocol();
+  std::cout << (failures == 0 ? "all checks passed" : "checks failed") << '\n';
+  return failures;
+}